@@ -0,0 +1,112 @@
+Mandelbrot set renderer
+80 by 38 characters with up to 30 iterations per point
+Fixed point arithmetic with 5 fraction bits on sign and magnitude cell pairs
+where every multiplication is repeated addition with a carry countdown
+
+++++++++++++++++++++++++++++++++++++++>+>++++++++++++++++++++++++++++++++++++++<
+<[->>>++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++>+>++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++<<[->>>
+>>>>++++++++++++++++++++++++++++++>+[>>>++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++>+<<<<<<<<[->>>>>>>>>+>+<<<<<<<<<<]>>>>>>>>>>[-<<<<<<<<<
+<+>>>>>>>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]
+<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<<+>>]<++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++>+<<<<<<[->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+
+>>>>>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-
+]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<<+>>]<+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<->]<
+[->>>++++++++++++++++++++++++++++++++<<<<<<<<<<[->>>>>>>>>>>+>+<<<<<<<<<<<<]>>>>
+>>>>>>>>[-<<<<<<<<<<<<+>>>>>>>>>>>>]<[-<<<<<<<<<<<[->>>>>>>>>>>>+>+<<<<<<<<<<<<<
+]>>>>>>>>>>>>>[-<<<<<<<<<<<<<+>>>>>>>>>>>>>]<[-<<->>>+<<<[->>>>+>+<<<<<]>>>>>[-<
+<<<<+>>>>>]<[[-]<->]<[-<<<++++++++++++++++++++++++++++++++<<+>>>>>]<]<]<[-]+++++
++++++++++++++++++++++++++++<<<<<<<<[->>>>>>>>>+>+<<<<<<<<<<]>>>>>>>>>>[-<<<<<<<<
+<<+>>>>>>>>>>]<[-<<<<<<<<<[->>>>>>>>>>+>+<<<<<<<<<<<]>>>>>>>>>>>[-<<<<<<<<<<<+>>
+>>>>>>>>>]<[-<<->>>+<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<[[-]<->]<[-<<<++++++++
+++++++++++++++++++++++++<+>>>>]<]<]<[-]<<[->>+>+<<<]>>>[-<<<+>>>]<<[->+>+<<]>>[-
+<<+>>]--------------------------------------------------------------------------
+----------------------------------------------------->+<<[->>>+>+<<<<]>>>>[-<<<<
++>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<-
+>]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<<<<<<+>>>>>>]<<[-]+<<<<[->>>>>+>+<<<<<<]>>>>>
+>[-<<<<<<+>>>>>>]<[[-]<->]<[-<<<<<<<<<<[->>>>>>>>>>>+>+<<<<<<<<<<<<]>>>>>>>>>>>>
+[-<<<<<<<<<<<<+>>>>>>>>>>>>]<<<<<<<<<<<<[->>>>>>>>>>>+>+<<<<<<<<<<<<]>>>>>>>>>>>
+>[-<<<<<<<<<<<<+>>>>>>>>>>>>]>++++++++++++++++++++++++++++++++<<<<<<<<<<<[->>>>>
+>>>>>>>+>+<<<<<<<<<<<<<]>>>>>>>>>>>>>[-<<<<<<<<<<<<<+>>>>>>>>>>>>>]<[-<<<[->>>>+
+>+<<<<<]>>>>>[-<<<<<+>>>>>]<[-<<->>>+<<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<[[-]<
+->]<[-<<<++++++++++++++++++++++++++++++++<+>>>>]<]<]<[-]<<[-]<<<<<<<<<<<<[->>>>>
+>>>>>>>+>>+<<<<<<<<<<<<<<]>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<+>>>>>>>>>>>>>>]<<<<<<<<
+<<<<[->>>>>>>>>>+>>+<<<<<<<<<<<<]>>>>>>>>>>>>[-<<<<<<<<<<<<+>>>>>>>>>>>>]<<<<<<<
+<<<<<<<[->>>>>>>>>>>>>>+>+<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<+>>>>>
+>>>>>>>>>>]<[[-]<<<<<<<<<<<<[->>>>>>>>>>>>>+>+<<<<<<<<<<<<<<]>>>>>>>>>>>>>>[-<<<
+<<<<<<<<<<<+>>>>>>>>>>>>>>]<[[-]<<<[-]>>>]<]<<[->>+>+<<<]>>>[-<<<+>>>]<<<<<<<<<<
+<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>+>+<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>[-<<<
+<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>]<->+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<<<
+<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>+>>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>
+>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]<]<[->+<<<[->>>>+>+<<<<<]>>>>>[-
+<<<<<+>>>>>]<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>+>+<<<<<<<<<<<<<<<<<<<
+<<<<]>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>]<[
+>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]+<[->>+>+<<<]>
+>>[-<<<+>>>]<[[-]<-<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>+>+<<<<<<<<<<<<
+<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>
+>>>>>>>>]<[-<<<<<<->>>>>>]<]<[-<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>+>+<
+<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>
+>>>>>>>>>>>>>>>]<<<<<<[->>>>>-<<<<<]>>>>>[-<<<<<+>>>>>]<<<<<<[-]<<<<<<<<<<<<<<<<
+<[->>>>>>>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>[-<<<
+<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>]<]<[-]<]<[-]<<<<<<<<<<<<[-]>[-]>>>>
+>>>>>[-<<<<<<<<<<+>>>>>>>>>>]>[-<<<<<<<<<<+>>>>>>>>>>]>+<<<<<[->>>>>>+>+<<<<<<<]
+>>>>>>>[-<<<<<<<+>>>>>>>]<<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<[>+<
+<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]+<[->>+>+<<<]>>>[
+-<<<+>>>]<[[-]<-<<<<<<[->>>>+>>>>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<<<<<<<[-
+>>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<[-<<<<->>>>]<]<[-<<<+<<[->>>+>>>
++<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<<<<<<<[->>>>>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>
+>>>>>]<[-<<<->>>]<]<[-]<<[->>+>+<<<]>>>[-<<<+>>>]<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>
+>>>>+>+<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>]
+<->+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>+>>>>+<<<<<<
+<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>]<]<[->+<<
+<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>+>+<<
+<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>
+>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]+<[->>+>+
+<<<]>>>[-<<<+>>>]<[[-]<-<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>+>+<<<<<<<<<<<<<
+<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]<[-<
+<<<<<->>>>>>]<]<[-<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>+>+<<<<<<<<<<<<<<<<<<<<
+]>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>]<<<<<<[->>>>>-<
+<<<<]>>>>>[-<<<<<+>>>>>]<<<<<<[-]<<<<<<<<<<<<<<[->>>>>>>>>>>>>>+>>>>>>+<<<<<<<<<
+<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>]<]<[
+-]<]<[-]<<<<<<<<<<<<<<[-]>[-]>>>>>>>>>>>[-<<<<<<<<<<<<+>>>>>>>>>>>>]>[-<<<<<<<<<
+<<<+>>>>>>>>>>>>]<<]<<[-]>[-]<<]+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<[-]>+>>>]<[-
+<<<<->>>>>+<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<[[-]<->]<[-<<<<[-]>
+>>>]<]<[-]<<]>>>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->>+++++++++++++++++++++++
++++++++<<<<<<[->>>>>>-<<<<<<]>>>++++++++++++++++++++++++++++++++>>>>++>+<<[->>>+
+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-
+<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>]<<[[-]<<<<+++++
++++++++++>>>>]>[-]<+++>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+>+<<<<]>>>>[-<<<
+<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]
+>[-<+>>+<]>[-<+>]<<[[-]<<<<++++++++++++>>>>]>[-]<++++>+<<[->>>+>+<<<<]>>>>[-<<<<
++>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<-
+>]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>]<<[[-]<<<<------------->>>>]>[-]
+<+++++>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->
+>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>
+]<<[[-]<<<<++++++++++++++++>>>>]>[-]<+++++++>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<
+[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[
+-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>]<<[[-]<<<<------------------>>>>]>[-]<+++
++++++++>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[-
+>>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+
+>]<<[[-]<<<<->>>>]>[-]<+++++++++++++++>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+
+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>
+]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>]<<[[-]<<<<----->>>>]>[-]<++++++++++++++++++++>+
+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[>+<<[->>>+>+<<<
+<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]<<[-]>[-<+>>+<]>[-<+>]<<[[-]<
+<<<+++++++++++++++++++++++++++>>>>]>[-]<<[-]<]<[-<++++++++++++++++++++++++++++++
++++++>]<.[-]<<<<<<<[-]>[-]>[-]>[-]>[-]>>[-]<<<<<<+<<[->>>>+>+<<<<<]>>>>>[-<<<<<+
+>>>>>]<<[->+>+<<]>>[-<<+>>]<->+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<[-<+>>>>>>+<<<
+<<]>>>>>[-<<<<<+>>>>>]<]<[->+<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<<
+<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>
+>>]<[[-]<->]<[-<<<[-]>+>>]<<->-]<[-]+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<<<[->>>>
+>>>+>+<<<<<<<<]>>>>>>>>[-<<<<<<<<+>>>>>>>>]<[-<<<<<<<<->>>>>>>>]<]<[-<<<<<[->>>>
+>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<<<<<<<<[->>>>>>>-<<<<<<<]>>>>>>>[-<<<<<<<
++>>>>>>>]<<<<<<<<[-]>>>[-<<<+>>>>>>>>+<<<<<]>>>>>[-<<<<<+>>>>>]<]<[-]<]<[-]<<[-]
+<<<]>>>++++++++++.[-]<<[-]>[-]<<++<<[->>>>+>+<<<<<]>>>>>[-<<<<<+>>>>>]<<[->+>+<<
+]>>[-<<+>>]<->+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<[-<+>>>>>>+<<<<<]>>>>>[-<<<<<+
+>>>>>]<]<[->+<<<<<[->>>>>>+>+<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<<<<<<[->>>>>>+>+<
+<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<[>+<<[->>>+>+<<<<]>>>>[-<<<<+>>>>]<[[-]<->]<[-<
+<<[-]>+>>]<<->-]<[-]+<[->>+>+<<<]>>>[-<<<+>>>]<[[-]<-<<<<<[->>>>>>>+>+<<<<<<<<]>
+>>>>>>>[-<<<<<<<<+>>>>>>>>]<[-<<<<<<<<->>>>>>>>]<]<[-<<<<<[->>>>>>+>+<<<<<<<]>>>
+>>>>[-<<<<<<<+>>>>>>>]<<<<<<<<[->>>>>>>-<<<<<<<]>>>>>>>[-<<<<<<<+>>>>>>>]<<<<<<<
+<[-]>>>[-<<<+>>>>>>>>+<<<<<]>>>>>[-<<<<<+>>>>>]<]<[-]<]<[-]<<[-]<<<]
@@ -0,0 +1,18 @@
+Sieve of Eratosthenes over the numbers 2 to 241 run 3000 times
+Prints a line per run with a hash for every prime and a dot otherwise
+Each number gets 7 cells and the multiples are marked by carrying the prime
+and a countdown along the tape
+
+>>>>>++++++++++++[->++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++[->>>+++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
++++++++++++++++++++++++++++++++++++[<<[-]+>[-]+>>>>>[-]+<<<<-[->>>>>>>+<<<<<<<]>
+>>>>>>]<<[-]+>>>>>>[-]<<<<<<[<<<<<<<]>>>>>>>>>++<[>>>>>[-<+<+>>]<[->+<]<[[-]<<<<
+->>[->>>+>>>>+>+<<<<<<<<]>>>[-<<<+>>>]>>>[>>->+<[[->>>>>>>+<<<<<<<]>-<]>[->>[-]<
+<<<[->>>>>>>>+<<<<<+<<<]>>>[-<<<+>>>]<]<<[->>>>>>>+<<<<<<<]>>>>>>]>[-]>[-]<<<[<<
+<<<<<]+>>>>]++++++++++++++++++++++++++++++++++++++++++++++>>[-<+<----------->>]<
+[->+<]<.[-]<<[->>>>>>>+<<<<<<<]>>>>>>>+<]>[-]>>++++++++++.[-]<<<<[<<<<<<<]>>>>>>
+]<]
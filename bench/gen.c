@@ -0,0 +1,132 @@
+/*
+ * Writes a synthetic brainfuck program to stdout, for `bench/scale.sh`.
+ *
+ * Usage: gen <bytes> [--depth=<n>] [--run=<n>] [--comments=<percent>] [--seed=<n>]
+ *
+ * bytes: About how long the program is.
+ * --depth: How deep loops may nest, 16 by default.
+ * --run: How long runs of the same command are on average, 4 by default.
+ * --comments: How many of the bytes are comments, 10 by default.
+ * --seed: For a different program of the same shape, 1 by default.
+ *
+ * The same arguments always give the same program, whatever the libc.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_LENGTH (80)
+
+static unsigned long g_state = 1;
+
+/*
+ * xorshift32, since `rand()` differs from libc to libc.
+ */
+static unsigned long next_random(void) {
+  g_state ^= (g_state << 13) & 0xffffffffUL;
+  g_state ^= g_state >> 17;
+  g_state ^= (g_state << 5) & 0xffffffffUL;
+  return g_state;
+}
+
+/*
+ * Returns a number in `[0, n)`.
+ */
+static long random_below(long n) {
+  return (long)(next_random() % (unsigned long)n);
+}
+
+static long g_written = 0;
+
+static void put(char c) {
+  putchar(c);
+  ++g_written;
+  if (!(g_written % LINE_LENGTH)) {
+    putchar('\n');
+    ++g_written;
+  }
+}
+
+/*
+ * If `arg` is `name=<number>`, sets `*value` to the number and returns `1`.
+ */
+static int parse_option(const char* arg, const char* name, long* value) {
+  const size_t name_len = strlen(name);
+
+  if (strncmp(arg, name, name_len) || '=' != arg[name_len]) {
+    return 0;
+  }
+  *value = atol(arg + name_len + 1);
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  const char runs[] = "+-><";
+  const char letters[] = "abcdefghijklmnopqrstuvwxyz    ";
+  long bytes = 0;
+  long max_depth = 16;
+  long run_length = 4;
+  long comments = 10;
+  long seed = 1;
+  long depth = 0;
+  long n = 0;
+  long i = 0;
+  int r = 0;
+
+  if (argc < 2 || (bytes = atol(argv[1])) <= 0) {
+    fprintf(stderr, "Usage: %s <bytes> [--depth=<n>] [--run=<n>] [--comments=<percent>] [--seed=<n>]\n", argv[0]);
+    return 1;
+  }
+  for (i = 2; i < argc; ++i) {
+    if (
+      !parse_option(argv[i], "--depth", &max_depth)
+      && !parse_option(argv[i], "--run", &run_length)
+      && !parse_option(argv[i], "--comments", &comments)
+      && !parse_option(argv[i], "--seed", &seed)
+    ) {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (max_depth < 0 || run_length < 1 || comments < 0 || comments > 100) {
+    fprintf(stderr, "Invalid option value\n");
+    return 1;
+  }
+  g_state = (unsigned long)seed * 2654435761UL % 0xffffffffUL;
+  if (!g_state) {
+    g_state = 1;
+  }
+
+  /* Whatever is left once only the open loops fit is spent closing them */
+  while (g_written + depth < bytes) {
+    if (random_below(100) < comments) {
+      put(letters[random_below(sizeof (letters) - 1)]);
+      continue;
+    }
+
+    /* Loops open slightly more often than they close, so they nest deeply */
+    r = random_below(100);
+    if (r < 9 && depth < max_depth) {
+      put('[');
+      ++depth;
+    } else if (r < 16 && depth > 0) {
+      put(']');
+      --depth;
+    } else if (r < 18) {
+      put(r < 17 ? '.' : ',');
+    } else {
+      n = 1 + random_below(2 * run_length - 1);
+      r = runs[random_below(sizeof (runs) - 1)];
+      for (i = 0; i < n && g_written + depth < bytes; ++i) {
+        put(r);
+      }
+    }
+  }
+  while (depth--) {
+    put(']');
+  }
+  putchar('\n');
+
+  return 0;
+}
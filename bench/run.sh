@@ -0,0 +1,66 @@
+#!/bin/sh
+# Compiles every program of bench/corpus.txt with bfc, runs each a few times
+# and compares the numbers against bench/baseline.txt.
+#
+# Usage: bench/run.sh [--save]
+#
+# --save: Overwrite the baseline with the numbers of this run.
+#
+# Environment:
+# RUNS: How many timed runs each program gets, 5 by default.
+# BFCFLAGS: Extra options for bfc, like --simd=none.
+
+set -e
+
+cd "$(dirname "$0")"
+
+SAVE=$1
+RUNS=${RUNS:-5}
+BASELINE=baseline.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# The same text everywhere, for the filters
+yes 'The quick brown fox jumps over the lazy dog, 0123456789 times!' | head -c 1000000 > "$WORK/text"
+
+echo "# program median_ms variance_ms2 code_bytes syscalls" > "$WORK/results"
+printf '%-16s %12s %12s %10s %10s   %s\n' program median_ms variance code_bytes syscalls 'vs baseline'
+
+grep -v '^#' corpus.txt | while read -r program input limit options; do
+  [ -n "$program" ] || continue
+
+  name=$(basename "$program" .bf)
+  case "$input" in
+    -) input=/dev/null ;;
+    text) input="$WORK/text" ;;
+  esac
+
+  if ! ../bfc $BFCFLAGS $options "$program" -o "$WORK/$name" 2> "$WORK/$name.log"; then
+    echo "$name: Could not compile, see:" >&2
+    tail -n 5 "$WORK/$name.log" >&2
+    exit 1
+  fi
+  code_bytes=$(wc -c < "$WORK/$name" | tr -d ' ')
+
+  numbers=$(./runner "$RUNS" "$WORK/$name" "$input" "$limit") || exit 1
+  set -- $numbers
+  median=$1
+  variance=$2
+  syscalls=$3
+  echo "$name $median $variance $code_bytes $syscalls" >> "$WORK/results"
+
+  comparison=$(awk -v name="$name" -v median="$median" -v bytes="$code_bytes" -v syscalls="$syscalls" '
+    $1 == name {
+      printf "%+.1f%% time, %+d bytes, %+d syscalls", (median - $2) * 100 / $2, bytes - $4, syscalls - $5
+      found = 1
+    }
+    END { if (!found) printf "new" }
+  ' "$BASELINE" 2> /dev/null || echo 'no baseline')
+
+  printf '%-16s %12s %12s %10s %10s   %s\n' "$name" "$median" "$variance" "$code_bytes" "$syscalls" "$comparison"
+done
+
+if [ "$SAVE" = "--save" ]; then
+  cp "$WORK/results" "$BASELINE"
+  echo "Saved as the new baseline."
+fi
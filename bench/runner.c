@@ -0,0 +1,268 @@
+/*
+ * Runs a compiled program several times and reports how long it took and
+ * how many syscalls it made, for `bench/run.sh`.
+ *
+ * Usage: runner <runs> <executable> <input path> <output limit>
+ *
+ * Prints `<median ms> <variance ms^2> <syscalls>` on a single line. The
+ * program reads `input path` and its output is read back through a pipe;
+ * once `output limit` bytes came out, if not `0`, the program is killed,
+ * which is how programs that never stop get measured.
+ */
+
+/* Needed for ptrace options, kill() and clock_gettime() under -std=c89 */
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RUNS (1000)
+
+static double get_seconds(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * Starts `path` with stdin from `input_path` and stdout into `*output_fd`,
+ * stopped at its first instruction if `traced`.
+ *
+ * Returns the pid, or `-1` on failure.
+ */
+static pid_t start(const char* path, const char* input_path, int traced, int* output_fd) {
+  int fds[2];
+  int input_fd = -1;
+  pid_t pid = -1;
+
+  input_fd = open(input_path, O_RDONLY);
+  if (-1 == input_fd) {
+    fprintf(stderr, "runner: Could not open %s\n", input_path);
+    return -1;
+  }
+  if (pipe(fds)) {
+    close(input_fd);
+    return -1;
+  }
+
+  pid = fork();
+  if (!pid) {
+    dup2(input_fd, 0);
+    dup2(fds[1], 1);
+    close(input_fd);
+    close(fds[0]);
+    close(fds[1]);
+    if (traced) {
+      ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+    }
+    execl(path, path, (char*)NULL);
+    _exit(127);
+  }
+
+  close(input_fd);
+  close(fds[1]);
+  if (-1 == pid) {
+    close(fds[0]);
+    return -1;
+  }
+  *output_fd = fds[0];
+  return pid;
+}
+
+/*
+ * Reads whatever output is there, and kills the program once it printed
+ * `limit` bytes in total.
+ *
+ * Returns `1` once the output is closed or the limit was reached.
+ */
+static int drain(int fd, pid_t pid, long limit, long* printed) {
+  char buf[65536];
+  ssize_t got = 0;
+
+  got = read(fd, buf, sizeof (buf));
+  if (got <= 0) {
+    return got == 0 || EAGAIN != errno;
+  }
+
+  *printed += got;
+  if (limit && *printed >= limit) {
+    kill(pid, SIGKILL);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Returns if `status` is how a program the runner didn't kill should end.
+ */
+static int exited_cleanly(int status, int killed) {
+  if (killed) {
+    return 1;
+  }
+  return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+/*
+ * Runs the program once, untraced.
+ *
+ * On success, returns `1` and sets `*seconds`.
+ */
+static int time_run(const char* path, const char* input_path, long limit, double* seconds) {
+  double started = get_seconds();
+  long printed = 0;
+  int output_fd = -1;
+  int killed = 0;
+  int status = 0;
+  pid_t pid = start(path, input_path, 0, &output_fd);
+
+  if (-1 == pid) {
+    return 0;
+  }
+
+  while (!drain(output_fd, pid, limit, &printed)) {
+  }
+  killed = limit && printed >= limit;
+  waitpid(pid, &status, 0);
+  *seconds = get_seconds() - started;
+  close(output_fd);
+
+  if (!exited_cleanly(status, killed)) {
+    fprintf(stderr, "runner: %s failed\n", path);
+    return 0;
+  }
+  return 1;
+}
+
+/*
+ * Runs the program once under ptrace, counting the syscalls it enters.
+ *
+ * On success, returns `1` and sets `*syscalls`.
+ */
+static int count_syscalls(const char* path, const char* input_path, long limit, long* syscalls) {
+  struct pollfd output_poll;
+  long printed = 0;
+  int output_fd = -1;
+  int output_done = 0;
+  int in_syscall = 0;
+  int killed = 0;
+  int status = 0;
+  int signal_n = 0;
+  pid_t pid = start(path, input_path, 1, &output_fd);
+
+  if (-1 == pid) {
+    return 0;
+  }
+
+  *syscalls = 0;
+
+  /* Stopped right after the exec */
+  waitpid(pid, &status, 0);
+  if (!WIFSTOPPED(status)) {
+    fprintf(stderr, "runner: Could not trace %s\n", path);
+    close(output_fd);
+    return 0;
+  }
+  ptrace(PTRACE_SETOPTIONS, pid, NULL, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+  ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+  /* The program blocks on a full pipe, so its output is read in between */
+  fcntl(output_fd, F_SETFL, O_NONBLOCK);
+  output_poll.fd = output_fd;
+  output_poll.events = POLLIN;
+
+  for (;;) {
+    if (!output_done && drain(output_fd, pid, limit, &printed)) {
+      output_done = 1;
+      killed = limit && printed >= limit;
+    }
+
+    if (!waitpid(pid, &status, WNOHANG)) {
+      poll(&output_poll, output_done ? 0 : 1, 1);
+      continue;
+    }
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
+      break;
+    }
+
+    signal_n = WSTOPSIG(status);
+    if ((SIGTRAP | 0x80) == signal_n) {
+      /* Every syscall stops once on entry and once on exit */
+      if (!in_syscall) {
+        ++*syscalls;
+      }
+      in_syscall = !in_syscall;
+      signal_n = 0;
+    }
+    ptrace(PTRACE_SYSCALL, pid, NULL, (void*)(long)signal_n);
+  }
+  close(output_fd);
+
+  if (!exited_cleanly(status, killed)) {
+    fprintf(stderr, "runner: %s failed under ptrace\n", path);
+    return 0;
+  }
+  return 1;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  const double x = *(const double*)a;
+  const double y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+  double times[MAX_RUNS];
+  double mean = 0;
+  double median = 0;
+  double variance = 0;
+  long syscalls = 0;
+  long limit = 0;
+  int runs = 0;
+  int i = 0;
+
+  if (5 != argc) {
+    fprintf(stderr, "Usage: %s <runs> <executable> <input path> <output limit>\n", argv[0]);
+    return 1;
+  }
+
+  runs = atoi(argv[1]);
+  limit = atol(argv[4]);
+  if (runs < 1 || runs > MAX_RUNS || limit < 0) {
+    fprintf(stderr, "runner: Invalid runs or output limit\n");
+    return 1;
+  }
+
+  /* A broken pipe must not take the runner down with the program */
+  signal(SIGPIPE, SIG_IGN);
+
+  for (i = 0; i < runs; ++i) {
+    if (!time_run(argv[2], argv[3], limit, times + i)) {
+      return 1;
+    }
+    times[i] *= 1000;
+    mean += times[i] / runs;
+  }
+
+  qsort(times, runs, sizeof (double), compare_doubles);
+  median = runs % 2 ? times[runs / 2] : (times[runs / 2 - 1] + times[runs / 2]) / 2;
+  for (i = 0; i < runs; ++i) {
+    variance += (times[i] - mean) * (times[i] - mean) / (runs > 1 ? runs - 1 : 1);
+  }
+
+  if (!count_syscalls(argv[2], argv[3], limit, &syscalls)) {
+    return 1;
+  }
+
+  printf("%.3f %.3f %li\n", median, variance, syscalls);
+  return 0;
+}
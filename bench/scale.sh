@@ -0,0 +1,46 @@
+#!/bin/sh
+# Times every stage of bfc on synthetic programs of growing size, to see how
+# the compiler scales with its input.
+#
+# Usage: bench/scale.sh
+#
+# Prints a row per size, which plots as is, with the time of each stage in
+# milliseconds, the peak RSS and the total time per input byte. A per byte
+# time that keeps growing with the size means something is superlinear.
+#
+# Environment:
+# SIZES: The program sizes in bytes, from 1 KiB to 4 MiB by default.
+# GENFLAGS: Options for bench/gen, like --depth=1000 or --comments=50.
+# BFCFLAGS: Extra options for bfc, like --eval-steps=0.
+
+set -e
+
+cd "$(dirname "$0")"
+
+SIZES=${SIZES:-"1024 4096 16384 65536 262144 1048576 4194304"}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+printf '%10s %10s %10s %10s %10s %10s %10s %10s %12s %10s\n' \
+  bytes read lex optimize evaluate assemble write total peak_kib ns/byte
+
+for size in $SIZES; do
+  ./gen "$size" $GENFLAGS > "$WORK/program.bf"
+  bytes=$(wc -c < "$WORK/program.bf" | tr -d ' ')
+
+  if ! ./bfc-release --time $BFCFLAGS "$WORK/program.bf" -o "$WORK/program" 2> "$WORK/log"; then
+    echo "Could not compile $size bytes, see:" >&2
+    tail -n 5 "$WORK/log" >&2
+    exit 1
+  fi
+
+  awk -v bytes="$bytes" '
+    /^INFO: Stage / { ms[$3] = $5; rss = $9 }
+    /^INFO: Compiled in / { total = $4 }
+    END {
+      printf "%10d %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %12d %10.1f\n",
+        bytes, ms["read"], ms["lex"], ms["optimize"], ms["evaluate"], ms["assemble"], ms["write"],
+        total, rss, total * 1000000 / bytes
+    }
+  ' "$WORK/log"
+done
@@ -0,0 +1,90 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+/* Most allocations are tiny, see `arena_alloc()` for the big ones */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Enough for any of the types we allocate */
+#define ARENA_ALIGNMENT (16)
+
+#define ALIGN_UP(N) (((N) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+struct ArenaBlock {
+  ArenaBlock* previous;
+  size_t size;
+  size_t used;
+};
+
+/* The data of a block comes right after its aligned header */
+#define BLOCK_DATA(BLOCK) ((char*)(BLOCK) + ALIGN_UP(sizeof (ArenaBlock)))
+
+void create_arena(Arena* arena) {
+  arena->block = NULL;
+}
+
+static ArenaBlock* create_block(size_t size) {
+  ArenaBlock* block = malloc(ALIGN_UP(sizeof (ArenaBlock)) + size);
+
+  if (block) {
+    block->previous = NULL;
+    block->size = size;
+    block->used = 0;
+  }
+
+  return block;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+  ArenaBlock* block = arena->block;
+  void* ptr = NULL;
+
+  size = ALIGN_UP(size ? size : 1);
+
+  if (block && block->used + size <= block->size) {
+    ptr = BLOCK_DATA(block) + block->used;
+    block->used += size;
+    return ptr;
+  }
+
+  if (size > ARENA_BLOCK_SIZE / 4) {
+    /* Big ones get a block of their own, so the current one keeps its room */
+    block = create_block(size);
+    if (!block) {
+      return NULL;
+    }
+    block->used = size;
+
+    if (arena->block) {
+      block->previous = arena->block->previous;
+      arena->block->previous = block;
+    } else {
+      arena->block = block;
+    }
+
+    return BLOCK_DATA(block);
+  }
+
+  block = create_block(ARENA_BLOCK_SIZE);
+  if (!block) {
+    return NULL;
+  }
+  block->previous = arena->block;
+  arena->block = block;
+
+  block->used = size;
+  return BLOCK_DATA(block);
+}
+
+void free_arena(Arena* arena) {
+  ArenaBlock* block = arena->block;
+  ArenaBlock* previous = NULL;
+
+  while (block) {
+    previous = block->previous;
+    free(block);
+    block = previous;
+  }
+
+  arena->block = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef BFC_ARENA_H
+#define BFC_ARENA_H
+
+#include <stddef.h>
+
+/*
+ * A bump allocator, everything allocated from it lives until `free_arena()`
+ * releases all of it at once, so a whole compilation never has to free its
+ * pieces one by one.
+ */
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+  /* The block allocations are bumped from, it links to the previous ones */
+  ArenaBlock* block;
+} Arena;
+
+void create_arena(Arena* arena);
+
+/*
+ * Returns `size` bytes aligned for any type, or `NULL` if out of memory.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/*
+ * Releases everything that was ever allocated from `arena`.
+ */
+void free_arena(Arena* arena);
+
+#endif /* ifndef BFC_ARENA_H */
@@ -0,0 +1,19 @@
+#include "assembler.h"
+#include "io_buf.h"
+
+#include <assert.h>
+
+void patch_data_address(AssemblerResult* result, unsigned long address) {
+  assert(result->data_address_offset > 0);
+
+  patch_le_in_buf(&result->code, result->data_address_offset, address, 8);
+}
+
+void free_assembler_result(AssemblerResult* result) {
+  if (result->code.ptr) {
+    free_io_buf(&result->code);
+  }
+  if (result->initial_data.ptr) {
+    free_io_buf(&result->initial_data);
+  }
+}
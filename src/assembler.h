@@ -1,6 +1,7 @@
 #ifndef BFC_ASSEMBLER_H
 #define BFC_ASSEMBLER_H
 
+#include "evaluator.h"
 #include "op.h"
 #include "io_buf.h"
 #include "optimizer.h"
@@ -12,21 +13,73 @@ typedef struct {
   IoBuf code;
 
   /*
-   * Initial stack state, cached.
+   * Offset within `code` of a 64-bit absolute address that must be patched
+   * with the address the data segment ends up at, see `patch_data_address()`.
+   */
+  int data_address_offset;
+
+  /*
+   * Size of the data segment, the tape lives in it.
+   */
+  int data_size;
+
+  /*
+   * What the data segment starts with, the rest of it is zero initialized.
    *
-   * `NULL` would mean there is none.
+   * `NULL_IO_BUF` would mean there is none.
    */
-  IoBuf initial_stack;
+  IoBuf initial_data;
 } AssemblerResult;
 
 typedef struct Assembler {
   OptimizationInfo optimization_info;
-  Op* ops;
-  
-  void (*assemble)(struct Assembler* self, AssemblerResult* result);
+  const Ops* ops;
+
+  /*
+   * If not `NULL`, the program starts from this state rather than from `ops`.
+   */
+  const Evaluation* evaluation;
+
+  /*
+   * If set, the code is a System V function that returns `0` to its caller
+   * once the program is done, rather than exiting, so it can run in-process.
+   */
+  int callable;
+
+  /*
+   * If not `NULL`, the code counts how often every loop is entered and
+   * iterated, and writes the counts to this path once the program is done,
+   * see `profile.h`.
+   */
+  const char* profile_path;
+
+  /*
+   * If not `NULL`, the `ProfileHeat` of every op from a profile, which
+   * decides where code size is worth spending.
+   */
+  const unsigned char* heats;
+
+  /*
+   * What `ops` came from, so the program can point at the line it was on
+   * when its pointer leaves the tape.
+   */
+  const Source* src;
+
+  /*
+   * On success, returns `1`, the caller frees `result` either way.
+   */
+  int (*assemble)(struct Assembler* self, AssemblerResult* result);
 } Assembler;
 
 extern const Assembler G_X86_64_ASSEMBLER_TEMPLATE;
 
+/*
+ * Fills in the data segment address in `result->code`, once the container
+ * decided where it lives.
+ */
+void patch_data_address(AssemblerResult* result, unsigned long address);
+
+void free_assembler_result(AssemblerResult* result);
+
 #endif /* ifndef BFC_ASSEMBLER_H */
 
@@ -1,300 +1,2684 @@
 #include "assembler.h"
 #include "io_buf.h"
+#include "log.h"
 #include "op.h"
+#include "parameters.h"
+#include "profile.h"
 
 #include <stddef.h>
+#include <string.h>
 #include <assert.h>
-#include <stdio.h>
 
 /*
  * Due to jumps being relative to the NEXT instruction after
  * the jumps, we need to store these magical constants, which
  * aren't that magical.
  *
- * These constants is just the size in bytes that an [ or ]
- * take up in the final machine code, that includes
- * the `mov al, [rsp]`, `test al, al` and `je/jne ...`.
+ * These constants is just the size in bytes of the `je/jne ...`
+ * that ends an [ or ], after whatever pointer move and test it has.
  */
 /* The short version has an imm8 for the jump */
-#define IF_OP_CODE_SIZE_SHORT (7)
+#define IF_JUMP_SIZE_SHORT (2)
 /* The near version has an imm32 for the jump */
-#define IF_OP_CODE_SIZE_NEAR (11)
+#define IF_JUMP_SIZE_NEAR (6)
 
-/* How much we move the stack pointer initially */
-#define INITIAL_STACK_FRAME (30000)
+/*
+ * Zeroed bytes after the tape, so vector loads near its end stay within its
+ * mapping, and scans that run off the tape stop there. There are none before
+ * it, where a pointer faults as soon as it leaves the tape.
+ */
+#define TAPE_PADDING (32)
+
+/*
+ * Inaccessible address space on both sides of the tape, so a pointer that
+ * leaves it faults rather than reaching anything else.
+ */
+#define TAPE_GUARD_SIZE (1 << 20)
+#define PAGE_SIZE (4096)
+
+/*
+ * Where the generated code keeps what it needs to undo its setup when it's
+ * `Assembler.callable`, relative to the end of the input buffer: the address
+ * of the tape mapping, then the SIGSEGV action it replaced.
+ */
+#define TAPE_MAPPING_SLOT (0)
+#define OLD_SIGACTION_SLOT (8)
+#define SLOTS_SIZE (8 + 32)
+
+/*
+ * The most ops a hot loop may have for its body to be written twice.
+ */
+#define MAX_UNROLLED_OPS (64)
+
+/*
+ * The fewest bytes a run of prints of known bytes must print to be printed
+ * as a string, see `find_printed_string()`. Below that, storing them one by
+ * one is both smaller and faster than the call and the `rep movsb`.
+ */
+#define MIN_PRINTED_STRING_SIZE (16)
+
+/*
+ * The most bytes a block of straight-line ops may write for
+ * `find_block_effects()` to look into it.
+ */
+#define MAX_BLOCK_CELLS (64)
+
+/*
+ * What loading a window of bytes costs, in instructions, see
+ * `plan_vector_windows()`.
+ */
+#define VECTOR_LOAD_COST (8)
+
+/*
+ * The generated code keeps the tape pointer in `rbx`, which points into a
+ * mapping of its own with guard areas on both sides, see
+ * `write_tape_setup()`, so a pointer that leaves the tape stops the program
+ * with an error instead of stomping on anything.
+ *
+ * The data segment is laid out as the output that was evaluated at
+ * compile-time, the tape it left, the output buffer and the input buffer.
+ * When the optimizer proved how far the pointer goes, the whole tape is
+ * there instead, sized to fit, and nothing is mapped.
+ * `r12` points at the next free byte of the output buffer, `r13` at its end,
+ * which is also where the input buffer starts. `r15` points at the next
+ * unread byte of the input buffer and `rbp` at the end of what was read.
+ *
+ * `r14` and `r10` hold the addresses of the flush and refill routines, so the
+ * code of every `Op` can stay position independent. Prints of strings and
+ * vector constants are the exception, they are patched once the code stops
+ * moving, see `CodeReference`.
+ *
+ * When profiling, the data segment starts with the profile block instead,
+ * which `r9` points at, see `profile.h`.
+ */
+
+/*
+ * What is known about the registers in between the code of two `Op`s, all
+ * offsets being relative to `rbx`.
+ */
+typedef struct {
+  /*
+   * How far the pointer is from `rbx`, moves only change this, and the
+   * other ops address their bytes relative to it, so straight-line code
+   * never touches `rbx`.
+   */
+  int offset;
+
+  /*
+   * If `al` holds the byte at `al_offset`, so it doesn't have to be loaded.
+   */
+  int al_valid;
+  int al_offset;
+
+  /*
+   * If ZF is set exactly when the byte at `zf_offset` is 0, as left by the
+   * last arithmetic on it, so [ and ] don't have to test it.
+   */
+  int zf_valid;
+  int zf_offset;
+} CodeState;
+
+/*
+ * The jump of an [ or ], which is written as a short jump placeholder at
+ * first, and only filled in by `relax_bracket_jumps()` once all of the code
+ * is there.
+ */
+typedef struct {
+  /* Offset of the jump within the code, before any jump was made near */
+  int position;
+  /* Index of the other bracket's `BracketJump` */
+  int match;
+  /* `OP_IF_0` jumps if zero, `OP_IF_NOT_0` if not */
+  OpType type;
+  int is_near;
+  /* Offset of the end of the jump, once the jumps before it have their sizes */
+  int end;
+} BracketJump;
+
+/*
+ * Which source line the code at each offset comes from, for the SIGSEGV
+ * handler to point at, only noting where the line changes.
+ */
+typedef struct {
+  /* Pairs of `int`s, an offset within the code and its line */
+  IoBuf entries;
+  /* How far lines were counted in the source, and the line there */
+  int text_i;
+  int line;
+  int last_line;
+} LineTable;
+
+/*
+ * A rip-relative reference from the code to what is stored after it, the
+ * strings that get printed at once and the constants of vector instructions.
+ */
+typedef struct {
+  /* Offset of its rel32 within the code, before any jump was made near */
+  int rel_offset;
+  /* Offset within what is stored after the code, or `-1` for the print string routine */
+  int target;
+} CodeReference;
+
+int assemble_x86_64(Assembler* self, AssemblerResult* result);
+const Assembler G_X86_64_ASSEMBLER_TEMPLATE = {
+  .ops = NULL,
+  .optimization_info = {0},
+  .evaluation = NULL,
+  .callable = 0,
+  .profile_path = NULL,
+  .heats = NULL,
+  .src = NULL,
+  .assemble = assemble_x86_64
+};
+
+/*
+ * Writes `mov rbx, imm64`, where the `imm64` is left for
+ * `patch_data_address()`.
+ *
+ * Returns the offset of the `imm64` within `buf`.
+ */
+static int write_mov_data_address_to_rbx(IoBuf* buf) {
+  const unsigned char template[] = { 0x48, 0xbb };
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, 0, 8);
+
+  return buf->size - 8;
+}
+
+/*
+ * Writes the register setup that follows `write_mov_data_address_to_rbx()`,
+ * the output buffer being at `output_offset` in the data segment.
+ *
+ * Sets `*flush_rel_offset` to the offset of the `rel32` of the
+ * `lea r14, [rip+rel32]`, which must later point at the flush routine.
+ */
+static void write_prologue(IoBuf* buf, int output_offset, int* flush_rel_offset) {
+  const unsigned char lea_r12_template[] = { 0x4c, 0x8d, 0xa3 }; /* lea r12, [rbx+imm32] */
+  const unsigned char lea_r13_template[] = { 0x4d, 0x8d, 0xac, 0x24 }; /* lea r13, [r12+imm32] */
+  const unsigned char input_template[] = {
+    0x4d, 0x89, 0xef, /* mov r15, r13 */
+    0x4c, 0x89, 0xed /* mov rbp, r13 */
+  };
+  const unsigned char lea_r14_template[] = { 0x4c, 0x8d, 0x35 }; /* lea r14, [rip+imm32] */
+
+  write_to_buf(buf, lea_r12_template, sizeof (lea_r12_template));
+  write_le_to_buf(buf, output_offset, 4);
+  write_to_buf(buf, lea_r13_template, sizeof (lea_r13_template));
+  write_le_to_buf(buf, G_PARAMETERS.output_buffer_size, 4);
+  write_to_buf(buf, input_template, sizeof (input_template));
+  write_to_buf(buf, lea_r14_template, sizeof (lea_r14_template));
+  write_le_to_buf(buf, 0, 4);
+  *flush_rel_offset = buf->size - 4;
+}
+
+/*
+ * Writes `lea r10, [rip+rel32]`, which must come after anything that makes
+ * a syscall with a fourth argument.
+ *
+ * Returns the offset of the `rel32`, which must later point at the refill
+ * routine.
+ */
+static int write_lea_refill_to_r10(IoBuf* buf) {
+  const unsigned char template[] = { 0x4c, 0x8d, 0x15 }; /* lea r10, [rip+imm32] */
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, 0, 4);
+
+  return buf->size - 4;
+}
+
+static void write_call_flush(IoBuf* buf) {
+  const unsigned char template[] = { 0x41, 0xff, 0xd6 }; /* call r14 */
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Returns how many bytes `write_rbx_offset_operand()` writes for `offset`.
+ */
+static int rbx_offset_operand_size(int offset) {
+  if (!offset) {
+    return 1;
+  }
+  return offset >= -128 && offset < 128 ? 2 : 5;
+}
+
+/*
+ * Writes `[rbx+offset]` as the r/m operand for the register `reg`, choosing
+ * the shortest displacement that fits.
+ */
+static void write_rbx_offset_operand(IoBuf* buf, int reg, int offset) {
+  if (!offset) {
+    write_byte_to_buf(buf, 0x03 | (reg << 3)); /* mod=00 r/m=rbx */
+  } else if (offset >= -128 && offset < 128) {
+    write_byte_to_buf(buf, 0x43 | (reg << 3)); /* mod=01 r/m=rbx */
+    write_byte_to_buf(buf, offset);
+  } else {
+    write_byte_to_buf(buf, 0x83 | (reg << 3)); /* mod=10 r/m=rbx */
+    write_le_to_buf(buf, offset, 4);
+  }
+}
+
+static void write_add_imm8_at_rbx(IoBuf* buf, int offset, int imm) {
+  if (1 == (imm & 0xff)) {
+    write_byte_to_buf(buf, 0xfe); /* inc byte [rbx+offset] */
+    write_rbx_offset_operand(buf, 0, offset);
+  } else if (0xff == (imm & 0xff)) {
+    write_byte_to_buf(buf, 0xfe); /* dec byte [rbx+offset] */
+    write_rbx_offset_operand(buf, 1, offset);
+  } else {
+    write_byte_to_buf(buf, 0x80); /* add byte [rbx+offset], imm8 */
+    write_rbx_offset_operand(buf, 0, offset);
+    write_byte_to_buf(buf, imm);
+  }
+}
+
+static void write_add_imm8_to_al(IoBuf* buf, int imm) {
+  if (1 == (imm & 0xff)) {
+    write_byte_to_buf(buf, 0xfe); /* inc al */
+    write_byte_to_buf(buf, 0xc0);
+  } else if (0xff == (imm & 0xff)) {
+    write_byte_to_buf(buf, 0xfe); /* dec al */
+    write_byte_to_buf(buf, 0xc8);
+  } else {
+    write_byte_to_buf(buf, 0x04); /* add al, imm8 */
+    write_byte_to_buf(buf, imm);
+  }
+}
+
+static void write_set_at_rbx(IoBuf* buf, int offset, int value) {
+  write_byte_to_buf(buf, 0xc6); /* mov byte [rbx+offset], imm8 */
+  write_rbx_offset_operand(buf, 0, offset);
+  write_byte_to_buf(buf, value);
+}
+
+static void write_load_al_at_rbx(IoBuf* buf, int offset) {
+  write_byte_to_buf(buf, 0x8a); /* mov al, [rbx+offset] */
+  write_rbx_offset_operand(buf, 0, offset);
+}
+
+static void write_store_al_at_rbx(IoBuf* buf, int offset) {
+  write_byte_to_buf(buf, 0x88); /* mov [rbx+offset], al */
+  write_rbx_offset_operand(buf, 0, offset);
+}
+
+/*
+ * Adds `al` times `factor` to the byte at `offset`.
+ */
+static void write_mul_add(IoBuf* buf, int offset, int factor) {
+  if (1 == factor) {
+    write_byte_to_buf(buf, 0x00); /* add [rbx+offset], al */
+    write_rbx_offset_operand(buf, 0, offset);
+  } else if (-1 == factor) {
+    write_byte_to_buf(buf, 0x28); /* sub [rbx+offset], al */
+    write_rbx_offset_operand(buf, 0, offset);
+  } else {
+    /* imul ecx, eax, imm8 */
+    write_byte_to_buf(buf, 0x6b);
+    write_byte_to_buf(buf, 0xc8);
+    write_byte_to_buf(buf, factor);
+
+    write_byte_to_buf(buf, 0x00); /* add [rbx+offset], cl */
+    write_rbx_offset_operand(buf, 1, offset);
+  }
+}
+
+/*
+ * Moves by `stride` until the byte is 0, one byte at a time.
+ */
+static void write_scalar_scan(IoBuf* buf, int stride) {
+  const unsigned char template[] = {
+    0xeb, 0x07, /* jmp .test */
+    /* .loop: */
+    0x48, 0x81, 0xc3 /* add rbx, imm32 */
+  };
+  const unsigned char test_template[] = {
+    /* .test: */
+    0x80, 0x3b, 0x00, /* cmp byte [rbx], 0 */
+    0x75, 0xf4 /* jne .loop */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, stride, 4);
+  write_to_buf(buf, test_template, sizeof (test_template));
+}
+
+/*
+ * Returns the bits of a `pmovmskb` mask for the bytes that are a multiple of
+ * `abs_stride` away from the first one.
+ */
+static unsigned long get_stride_mask(int abs_stride, int width) {
+  unsigned long mask = 0;
+  int i = 0;
+
+  for (i = 0; i < width; i += abs_stride) {
+    mask |= 1UL << i;
+  }
+  return mask;
+}
+
+/*
+ * Moves right by `stride`, which must be 1, 2 or 4, until the byte is 0,
+ * comparing a whole vector of bytes at a time like `memchr()` does. The
+ * loads may read up to a vector past the byte that's found.
+ *
+ * Uses `xmm0`, `xmm1` and `rax`, or their `ymm` versions with AVX2.
+ */
+static void write_vector_scan_right(IoBuf* buf, int stride) {
+  const int avx2 = SIMD_EXTENSION_AVX2 == G_PARAMETERS.simd_extension;
+  const int width = avx2 ? 32 : 16;
+  const unsigned char sse2_template[] = {
+    0x66, 0x0f, 0xef, 0xc9, /* pxor xmm1, xmm1 */
+    /* .loop: */
+    0xf3, 0x0f, 0x6f, 0x03, /* movdqu xmm0, [rbx] */
+    0x66, 0x0f, 0x74, 0xc1, /* pcmpeqb xmm0, xmm1 */
+    0x66, 0x0f, 0xd7, 0xc0, /* pmovmskb eax, xmm0 */
+    0x25 /* and eax, imm32 */
+  };
+  const unsigned char avx2_template[] = {
+    0xc5, 0xf5, 0xef, 0xc9, /* vpxor ymm1, ymm1, ymm1 */
+    /* .loop: */
+    0xc5, 0xfe, 0x6f, 0x03, /* vmovdqu ymm0, [rbx] */
+    0xc5, 0xfd, 0x74, 0xc1, /* vpcmpeqb ymm0, ymm0, ymm1 */
+    0xc5, 0xfd, 0xd7, 0xc0, /* vpmovmskb eax, ymm0 */
+    0x25 /* and eax, imm32 */
+  };
+  const unsigned char next_template[] = {
+    0x75, 0x06, /* jnz .found */
+    0x48, 0x83, 0xc3 /* add rbx, imm8 */
+  };
+  const unsigned char found_template[] = {
+    0x0f, 0xbc, 0xc0, /* .found: bsf eax, eax */
+    0x48, 0x01, 0xc3 /* add rbx, rax */
+  };
+  const unsigned char vzeroupper_template[] = { 0xc5, 0xf8, 0x77 };
+  int loop_start = 0;
+
+  if (avx2) {
+    write_to_buf(buf, avx2_template, sizeof (avx2_template));
+  } else {
+    write_to_buf(buf, sse2_template, sizeof (sse2_template));
+  }
+  loop_start = buf->size - 13;
+  write_le_to_buf(buf, get_stride_mask(stride, width), 4);
+
+  write_to_buf(buf, next_template, sizeof (next_template));
+  write_byte_to_buf(buf, width);
+  /* jmp .loop */
+  write_byte_to_buf(buf, 0xeb);
+  write_byte_to_buf(buf, loop_start - (buf->size + 1));
+  write_to_buf(buf, found_template, sizeof (found_template));
+
+  if (avx2) {
+    write_to_buf(buf, vzeroupper_template, sizeof (vzeroupper_template));
+  }
+}
+
+/*
+ * Moves left by `-stride`, which must be 1, 2 or 4, until the byte is 0,
+ * like `write_vector_scan_right()` does. The loads are aligned, so they
+ * never read past the page of the bytes they compare, and the scan faults
+ * right when it leaves the tape like the scalar one would.
+ *
+ * Uses `xmm0`, `xmm1`, `rax`, `rcx` and `rdx`, or the `ymm` versions with
+ * AVX2.
+ */
+static void write_vector_scan_left(IoBuf* buf, int stride) {
+  const int avx2 = SIMD_EXTENSION_AVX2 == G_PARAMETERS.simd_extension;
+  const int width = avx2 ? 32 : 16;
+  const unsigned char sse2_zero_template[] = { 0x66, 0x0f, 0xef, 0xc9 }; /* pxor xmm1, xmm1 */
+  const unsigned char avx2_zero_template[] = { 0xc5, 0xf5, 0xef, 0xc9 }; /* vpxor ymm1, ymm1, ymm1 */
+  const unsigned char phase_template[] = {
+    0x89, 0xd9, /* mov ecx, ebx */
+    0x83, 0xe1 /* and ecx, imm8 */
+  };
+  const unsigned char shift_phase_template[] = { 0xd3, 0xe2 }; /* shl edx, cl */
+  const unsigned char first_template[] = {
+    /* Only the bytes up to the current one count in the first vector */
+    0xb8, 0xfe, 0xff, 0xff, 0xff, /* mov eax, -2 */
+    0xd3, 0xe0, /* shl eax, cl */
+    0xf7, 0xd0, /* not eax */
+    0x21, 0xd0, /* and eax, edx */
+    0x48, 0x83, 0xe3 /* and rbx, imm8 */
+  };
+  const unsigned char loop_template[] = {
+    0xeb, 0x06, /* jmp .test */
+    /* .loop: */
+    0x48, 0x83, 0xeb /* sub rbx, imm8 */
+  };
+  const unsigned char next_mask_template[] = { 0x89, 0xd0 }; /* mov eax, edx */
+  const unsigned char sse2_test_template[] = {
+    /* .test: */
+    0x66, 0x0f, 0x6f, 0x03, /* movdqa xmm0, [rbx] */
+    0x66, 0x0f, 0x74, 0xc1, /* pcmpeqb xmm0, xmm1 */
+    0x66, 0x0f, 0xd7, 0xc8 /* pmovmskb ecx, xmm0 */
+  };
+  const unsigned char avx2_test_template[] = {
+    /* .test: */
+    0xc5, 0xfd, 0x6f, 0x03, /* vmovdqa ymm0, [rbx] */
+    0xc5, 0xfd, 0x74, 0xc1, /* vpcmpeqb ymm0, ymm0, ymm1 */
+    0xc5, 0xfd, 0xd7, 0xc8 /* vpmovmskb ecx, ymm0 */
+  };
+  const unsigned char found_template[] = {
+    0x21, 0xc1, /* and ecx, eax */
+    0x74 /* jz .loop */
+  };
+  const unsigned char add_found_template[] = {
+    0x0f, 0xbd, 0xc9, /* bsr ecx, ecx */
+    0x48, 0x01, 0xcb /* add rbx, rcx */
+  };
+  const unsigned char vzeroupper_template[] = { 0xc5, 0xf8, 0x77 };
+  int loop_start = 0;
+
+  if (avx2) {
+    write_to_buf(buf, avx2_zero_template, sizeof (avx2_zero_template));
+  } else {
+    write_to_buf(buf, sse2_zero_template, sizeof (sse2_zero_template));
+  }
+
+  /* The bytes to compare are the ones as far from an aligned one as `rbx` */
+  write_byte_to_buf(buf, 0xba); /* mov edx, imm32 */
+  write_le_to_buf(buf, get_stride_mask(-stride, width), 4);
+  if (-1 != stride) {
+    write_to_buf(buf, phase_template, sizeof (phase_template));
+    write_byte_to_buf(buf, -stride - 1);
+    write_to_buf(buf, shift_phase_template, sizeof (shift_phase_template));
+  }
+
+  write_to_buf(buf, phase_template, sizeof (phase_template));
+  write_byte_to_buf(buf, width - 1);
+  write_to_buf(buf, first_template, sizeof (first_template));
+  write_byte_to_buf(buf, -width);
+
+  write_to_buf(buf, loop_template, sizeof (loop_template));
+  loop_start = buf->size - 3;
+  write_byte_to_buf(buf, width);
+  write_to_buf(buf, next_mask_template, sizeof (next_mask_template));
+  if (avx2) {
+    write_to_buf(buf, avx2_test_template, sizeof (avx2_test_template));
+  } else {
+    write_to_buf(buf, sse2_test_template, sizeof (sse2_test_template));
+  }
+  write_to_buf(buf, found_template, sizeof (found_template));
+  write_byte_to_buf(buf, loop_start - (buf->size + 1));
+  write_to_buf(buf, add_found_template, sizeof (add_found_template));
+
+  if (avx2) {
+    write_to_buf(buf, vzeroupper_template, sizeof (vzeroupper_template));
+  }
+}
+
+static void write_move_rbx(IoBuf* buf, int n);
+
+/*
+ * Moves by `offset`, as the scan needs the real pointer, and then scans,
+ * one byte at a time if `compact`, since that's less than half the code.
+ */
+static void write_scan(IoBuf* buf, int offset, int stride, int compact) {
+  const int abs_stride = stride > 0 ? stride : -stride;
+
+  write_move_rbx(buf, offset);
+
+  if (
+    compact
+    || SIMD_EXTENSION_NONE == G_PARAMETERS.simd_extension
+    || (1 != abs_stride && 2 != abs_stride && 4 != abs_stride)
+  ) {
+    write_scalar_scan(buf, stride);
+  } else {
+    if (stride > 0) {
+      write_vector_scan_right(buf, stride);
+    } else {
+      write_vector_scan_left(buf, stride);
+    }
+  }
+}
+
+static void write_add_imm32_to_rbx(IoBuf* buf, int imm) {
+  const unsigned char template[] = { 0x48, 0x81, 0xc3 };
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, imm, 4);
+}
+
+/*
+ * Applies a pending pointer move, if there is one, with a `lea` so the flags
+ * survive it.
+ */
+static void write_move_rbx(IoBuf* buf, int n) {
+  const unsigned char template[] = { 0x48, 0x8d }; /* lea rbx, [rbx+n] */
+
+  if (!n) {
+    return;
+  }
+
+  write_to_buf(buf, template, sizeof (template));
+  if (n >= -128 && n < 128) {
+    write_byte_to_buf(buf, 0x5b);
+    write_byte_to_buf(buf, n);
+  } else {
+    write_byte_to_buf(buf, 0x9b);
+    write_le_to_buf(buf, n, 4);
+  }
+}
+
+/*
+ * Writes the jump of a bracket of `type` to `at`, which has room for it.
+ */
+static void put_bracket_jump(char* at, OpType type, int is_near, int rel) {
+  const int jz = OP_IF_0 == type;
+  int i = 0;
+
+  if (!is_near) {
+    at[0] = jz ? 0x74 : 0x75; /* jz/jnz rel8 */
+    at[1] = rel;
+    return;
+  }
+
+  at[0] = 0x0f;
+  at[1] = jz ? 0x84 : 0x85; /* jz/jnz rel32 */
+  for (i = 0; i < 4; ++i, rel >>= 8) {
+    at[2 + i] = rel & 0xff;
+  }
+}
+
+static void write_test_al(IoBuf* buf) {
+  const unsigned char template[] = { 0x84, 0xc0 }; /* test al, al */
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Points `rel8` at `buf` at the end of `buf`.
+ */
+static void patch_rel8_to_end(IoBuf* buf, int rel8_offset) {
+  buf->ptr[rel8_offset] = buf->size - (rel8_offset + 1);
+}
+
+/*
+ * Adds `amount` to the byte at `target` if `al`, as set by `setne`, is 1.
+ */
+static void write_setne_add(IoBuf* buf, int target, int amount) {
+  const unsigned char setne_template[] = { 0x0f, 0x95, 0xc0 }; /* setne al */
+
+  write_to_buf(buf, setne_template, sizeof (setne_template));
+
+  if (1 == (amount & 0xff)) {
+    write_byte_to_buf(buf, 0x00); /* add [rbx+target], al */
+    write_rbx_offset_operand(buf, 0, target);
+  } else if (0xff == (amount & 0xff)) {
+    write_byte_to_buf(buf, 0x28); /* sub [rbx+target], al */
+    write_rbx_offset_operand(buf, 0, target);
+  } else {
+    write_byte_to_buf(buf, 0xf6); /* neg al */
+    write_byte_to_buf(buf, 0xd8);
+    write_byte_to_buf(buf, 0x24); /* and al, imm8 */
+    write_byte_to_buf(buf, amount);
+
+    write_byte_to_buf(buf, 0x00); /* add [rbx+target], al */
+    write_rbx_offset_operand(buf, 0, target);
+  }
+}
+
+/*
+ * Does what `OP_DIVMOD` does at once, for the byte at `offset`, before the
+ * [ of its loop, which is then skipped. If the bytes aren't in the shape
+ * for it, or the loop wouldn't be entered, it does nothing.
+ *
+ * Clobbers `rax`, `rcx` and `rdx`.
+ */
+static void write_divmod(IoBuf* buf, int offset, int divisor, int copy) {
+  const unsigned char divide_template[] = {
+    0xff, 0xc9, /* dec ecx ; so 0 means 256 */
+    0x0f, 0xb6, 0xc9, /* movzx ecx, cl */
+    0xff, 0xc1, /* inc ecx */
+    0x31, 0xd2, /* xor edx, edx */
+    0xf7, 0xf1 /* div ecx */
+  };
+  const int d = offset + divisor;
+  /* Of the jumps to the end */
+  int skips[3];
+  int i = 0;
+
+  write_byte_to_buf(buf, 0x0f); /* movzx eax, byte [rbx+offset] */
+  write_byte_to_buf(buf, 0xb6);
+  write_rbx_offset_operand(buf, 0, offset);
+  write_test_al(buf);
+  write_byte_to_buf(buf, 0x74); /* jz rel8 */
+  write_byte_to_buf(buf, 0);
+  skips[0] = buf->size - 1;
+
+  write_byte_to_buf(buf, 0x0f); /* movzx ecx, byte [rbx+d] */
+  write_byte_to_buf(buf, 0xb6);
+  write_rbx_offset_operand(buf, 1, d);
+  write_byte_to_buf(buf, 0x80); /* cmp cl, 1 */
+  write_byte_to_buf(buf, 0xf9);
+  write_byte_to_buf(buf, 1);
+  write_byte_to_buf(buf, 0x74); /* je rel8 */
+  write_byte_to_buf(buf, 0);
+  skips[1] = buf->size - 1;
+
+  write_byte_to_buf(buf, 0x8a); /* mov dl, [rbx+d+1] */
+  write_rbx_offset_operand(buf, 2, d + 1);
+  write_byte_to_buf(buf, 0x0a); /* or dl, [rbx+d+3] */
+  write_rbx_offset_operand(buf, 2, d + 3);
+  write_byte_to_buf(buf, 0x0a); /* or dl, [rbx+d+4] */
+  write_rbx_offset_operand(buf, 2, d + 4);
+  write_byte_to_buf(buf, 0x75); /* jnz rel8 */
+  write_byte_to_buf(buf, 0);
+  skips[2] = buf->size - 1;
+
+  if (copy) {
+    write_byte_to_buf(buf, 0x00); /* add [rbx+offset+copy], al */
+    write_rbx_offset_operand(buf, 0, offset + copy);
+  }
+  write_to_buf(buf, divide_template, sizeof (divide_template));
+  write_byte_to_buf(buf, 0x00); /* add [rbx+d+2], al ; the quotient */
+  write_rbx_offset_operand(buf, 0, d + 2);
+  write_byte_to_buf(buf, 0x88); /* mov [rbx+d+1], dl ; the remainder */
+  write_rbx_offset_operand(buf, 2, d + 1);
+  write_byte_to_buf(buf, 0x29); /* sub ecx, edx */
+  write_byte_to_buf(buf, 0xd1);
+  write_byte_to_buf(buf, 0x88); /* mov [rbx+d], cl */
+  write_rbx_offset_operand(buf, 1, d);
+  write_set_at_rbx(buf, offset, 0);
+
+  for (i = 0; i < 3; ++i) {
+    patch_rel8_to_end(buf, skips[i]);
+  }
+}
+
+/*
+ * Reads the next input byte into the byte at `offset`, straight from the
+ * input buffer, only calling the refill routine once it runs dry.
+ */
+static void write_input(IoBuf* buf, int offset) {
+  const char template[] = {
+    0x49, 0x39, 0xef, /* cmp r15, rbp */
+    0x73, 0x08, /* jae .refill */
+    0x41, 0x8a, 0x07, /* mov al, [r15] */
+    0x49, 0xff, 0xc7, /* inc r15 */
+    0xeb /* jmp .store */
+  };
+  const unsigned char refill_template[] = { 0x41, 0xff, 0xd2 }; /* .refill: call r10 */
+  /* .store: mov [rbx+offset], al */
+  const int store_size = 1 + rbx_offset_operand_size(offset);
+  const int unchanged_on_eof = EOF_BEHAVIOR_UNCHANGED == G_PARAMETERS.eof_behavior;
+
+  write_to_buf(buf, template, sizeof (template));
+  write_byte_to_buf(buf, sizeof (refill_template) + (unchanged_on_eof ? 2 : 0));
+  write_to_buf(buf, refill_template, sizeof (refill_template));
+  if (unchanged_on_eof) {
+    /* jc .skip */
+    write_byte_to_buf(buf, 0x72);
+    write_byte_to_buf(buf, store_size);
+  }
+  write_store_al_at_rbx(buf, offset);
+  /* .skip: */
+}
+
+/*
+ * Appends `al` `n` times to the output buffer, flushing it whenever it fills
+ * up, or on newlines if `G_PARAMETERS.line_buffered`.
+ */
+static void write_print(IoBuf* buf, int n) {
+  const unsigned char store_template[] = {
+    0x41, 0x88, 0x04, 0x24, /* mov [r12], al */
+    0x49, 0xff, 0xc4, /* inc r12 */
+    0x4d, 0x39, 0xec, /* cmp r12, r13 */
+    0x75, 0x03, /* jne +3 */
+    0x41, 0xff, 0xd6 /* call r14 */
+  };
+  const unsigned char newline_template[] = {
+    0x3c, 0x0a, /* cmp al, 10 */
+    0x75, 0x03, /* jne +3 */
+    0x41, 0xff, 0xd6 /* call r14 */
+  };
+  int i = 0;
+
+  for (i = 0; i < n; ++i) {
+    write_to_buf(buf, store_template, sizeof (store_template));
+    if (G_PARAMETERS.line_buffered) {
+      write_to_buf(buf, newline_template, sizeof (newline_template));
+    }
+  }
+}
+
+/*
+ * Appends `byte` `n` times to the output buffer, like `write_print()` does
+ * with `al`.
+ */
+static void write_print_const(IoBuf* buf, int byte, int n) {
+  const unsigned char full_template[] = {
+    0x4d, 0x39, 0xec, /* cmp r12, r13 */
+    0x75, 0x03, /* jne +3 */
+    0x41, 0xff, 0xd6 /* call r14 */
+  };
+  const unsigned char flush_template[] = { 0x41, 0xff, 0xd6 }; /* call r14 */
+  int i = 0;
+
+  for (i = 0; i < n; ++i) {
+    /* mov byte [r12], imm8 */
+    write_byte_to_buf(buf, 0x41);
+    write_byte_to_buf(buf, 0xc6);
+    write_byte_to_buf(buf, 0x04);
+    write_byte_to_buf(buf, 0x24);
+    write_byte_to_buf(buf, byte);
+
+    write_byte_to_buf(buf, 0x49); /* inc r12 */
+    write_byte_to_buf(buf, 0xff);
+    write_byte_to_buf(buf, 0xc4);
+
+    /* A newline flushes anyway, which also makes room */
+    if (G_PARAMETERS.line_buffered && '\n' == byte) {
+      write_to_buf(buf, flush_template, sizeof (flush_template));
+    } else {
+      write_to_buf(buf, full_template, sizeof (full_template));
+    }
+  }
+}
+
+/*
+ * Writes the routine that appends the `edx` bytes at `rsi` to the output
+ * buffer, flushing it whenever it fills up.
+ *
+ * Preserves every register other than `rcx`, `rdx`, `rsi`, `rdi`, `r12` and
+ * the flags.
+ */
+static void write_print_string_routine(IoBuf* buf) {
+  const unsigned char template[] = {
+    /* .loop: */
+    0x4c, 0x89, 0xe7, /* mov rdi, r12 */
+    0x4c, 0x89, 0xe9, /* mov rcx, r13 */
+    0x4c, 0x29, 0xe1, /* sub rcx, r12 */
+    0x48, 0x39, 0xd1, /* cmp rcx, rdx */
+    0x48, 0x0f, 0x47, 0xca, /* cmova rcx, rdx */
+    0x48, 0x29, 0xca, /* sub rdx, rcx */
+    0xf3, 0xa4, /* rep movsb */
+    0x49, 0x89, 0xfc, /* mov r12, rdi */
+    0x4d, 0x39, 0xec, /* cmp r12, r13 */
+    0x75, 0x03, /* jne +3 */
+    0x41, 0xff, 0xd6, /* call r14 */
+    0x48, 0x85, 0xd2, /* test rdx, rdx */
+    0x75, 0xdb, /* jnz .loop */
+    0xc3 /* ret */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Writes a rel32 to be patched with the address of `target`, see
+ * `CodeReference`, and appends it to `references`.
+ *
+ * Returns `0` if out of memory.
+ */
+static int write_code_reference(IoBuf* buf, IoBuf* references, int target) {
+  CodeReference reference;
+
+  reference.rel_offset = buf->size;
+  reference.target = target;
+  write_le_to_buf(buf, 0, 4);
+
+  return write_to_buf(references, &reference, sizeof (reference));
+}
+
+/*
+ * Writes a call to the print string routine with the `size` bytes at
+ * `target` after the code.
+ *
+ * Returns `0` if out of memory.
+ */
+static int write_print_string(IoBuf* buf, IoBuf* references, int target, int size) {
+  const unsigned char lea_template[] = { 0x48, 0x8d, 0x35 }; /* lea rsi, [rip+rel32] */
+
+  write_to_buf(buf, lea_template, sizeof (lea_template));
+  if (!write_code_reference(buf, references, target)) {
+    return 0;
+  }
+
+  write_byte_to_buf(buf, 0xba); /* mov edx, imm32 */
+  write_le_to_buf(buf, size, 4);
+
+  write_byte_to_buf(buf, 0xe8); /* call rel32 */
+  return write_code_reference(buf, references, -1);
+}
+
+static void write_exit_success_syscall(IoBuf* buf) {
+  const char template[] = {
+    0xb8, 0x3c, 0x00, 0x00, 0x00, /* mov rax, 0x3c */
+    0x48, 0x31, 0xff, /* xor rdi, rdi */
+    0x0f, 0x05 /* syscall */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Saves the registers the generated code uses that a System V caller
+ * expects to be preserved.
+ */
+static void write_push_callee_saved(IoBuf* buf) {
+  const unsigned char template[] = {
+    0x53, /* push rbx */
+    0x55, /* push rbp */
+    0x41, 0x54, /* push r12 */
+    0x41, 0x55, /* push r13 */
+    0x41, 0x56, /* push r14 */
+    0x41, 0x57 /* push r15 */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Restores what `write_push_callee_saved()` saved and returns `0`.
+ */
+static void write_return_success(IoBuf* buf) {
+  const unsigned char template[] = {
+    0x41, 0x5f, /* pop r15 */
+    0x41, 0x5e, /* pop r14 */
+    0x41, 0x5d, /* pop r13 */
+    0x41, 0x5c, /* pop r12 */
+    0x5d, /* pop rbp */
+    0x5b, /* pop rbx */
+    0x31, 0xc0, /* xor eax, eax */
+    0xc3 /* ret */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+static void write_exit_fail_syscall(IoBuf* buf) {
+  const char template[] = {
+    0xb8, 0x3c, 0x00, 0x00, 0x00, /* mov rax, 0x3c */
+    0xbf, 0x01, 0x00, 0x00, 0x00, /* mov rdi, 1 */
+    0x0f, 0x05 /* syscall */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+}
+
+/*
+ * Writes `rdx` bytes from `rsi` to stdout, as many `write`s as it takes,
+ * exits with failure if `write` does.
+ *
+ * Clobbers `rax`, `rcx`, `rdx`, `rsi`, `rdi` and `r11`.
+ */
+static void write_write_all(IoBuf* buf) {
+  const unsigned char template[] = {
+    0x48, 0x85, 0xd2, /* test rdx, rdx */
+    0x74, 0x27, /* jz .done */
+    /* .loop: */
+    0xb8, 0x01, 0x00, 0x00, 0x00, /* mov eax, 1 */
+    0xbf, 0x01, 0x00, 0x00, 0x00, /* mov edi, 1 */
+    0x0f, 0x05, /* syscall */
+    0x48, 0x85, 0xc0, /* test rax, rax */
+    0x7e, 0x0a, /* jle .fail */
+    0x48, 0x01, 0xc6, /* add rsi, rax */
+    0x48, 0x29, 0xc2, /* sub rdx, rax */
+    0x75, 0xe7, /* jnz .loop */
+    0xeb, 0x0c /* jmp .done */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+  /* .fail: */
+  write_exit_fail_syscall(buf);
+  /* .done: */
+}
+
+/*
+ * Writes the routine `r14` points to, which writes out everything between
+ * the start of the output buffer and `r12`, and resets `r12`.
+ *
+ * Preserves every register other than `r12` and the flags, exits with
+ * failure if `write` does.
+ */
+static void write_flush_routine(IoBuf* buf) {
+  const unsigned char template[] = {
+    0x50, /* push rax */
+    0x51, /* push rcx */
+    0x52, /* push rdx */
+    0x56, /* push rsi */
+    0x57, /* push rdi */
+    0x41, 0x53, /* push r11 */
+    0x4c, 0x89, 0xee, /* mov rsi, r13 */
+    0x48, 0x81, 0xee /* sub rsi, imm32 */
+  };
+  const unsigned char length_template[] = {
+    0x4c, 0x89, 0xe2, /* mov rdx, r12 */
+    0x48, 0x29, 0xf2 /* sub rdx, rsi */
+  };
+  const unsigned char reset_template[] = {
+    0x4d, 0x89, 0xec, /* mov r12, r13 */
+    0x49, 0x81, 0xec /* sub r12, imm32 */
+  };
+  const unsigned char ret_template[] = {
+    0x41, 0x5b, /* pop r11 */
+    0x5f, /* pop rdi */
+    0x5e, /* pop rsi */
+    0x5a, /* pop rdx */
+    0x59, /* pop rcx */
+    0x58, /* pop rax */
+    0xc3 /* ret */
+  };
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, G_PARAMETERS.output_buffer_size, 4);
+  write_to_buf(buf, length_template, sizeof (length_template));
+  write_write_all(buf);
+  write_to_buf(buf, reset_template, sizeof (reset_template));
+  write_le_to_buf(buf, G_PARAMETERS.output_buffer_size, 4);
+  write_to_buf(buf, ret_template, sizeof (ret_template));
+}
+
+/*
+ * Writes the routine `r10` points to, which flushes the output, reads as much
+ * input as fits into the input buffer, and returns the first byte in `al`.
+ *
+ * Returns with the carry flag set if there was no more input and the byte
+ * must be left unchanged, otherwise `al` follows `G_PARAMETERS.eof_behavior`.
+ *
+ * Preserves every register other than `rax`, `r15`, `rbp` and the flags.
+ */
+static void write_refill_routine(IoBuf* buf) {
+  const unsigned char template[] = {
+    0x41, 0xff, 0xd6, /* call r14 */
+    0x51, /* push rcx */
+    0x52, /* push rdx */
+    0x56, /* push rsi */
+    0x57, /* push rdi */
+    0x41, 0x53, /* push r11 */
+    0x4c, 0x89, 0xee, /* mov rsi, r13 */
+    0xba /* mov edx, imm32 */
+  };
+  const unsigned char read_template[] = {
+    0x31, 0xc0, /* xor eax, eax */
+    0x31, 0xff, /* xor edi, edi */
+    0x0f, 0x05, /* syscall */
+    0x48, 0x85, 0xc0, /* test rax, rax */
+    0x7e, 0x11, /* jle .eof */
+    0x49, 0x8d, 0x6c, 0x05, 0x00, /* lea rbp, [r13+rax] */
+    0x4d, 0x89, 0xef, /* mov r15, r13 */
+    0x41, 0x8a, 0x07, /* mov al, [r15] */
+    0x49, 0xff, 0xc7, /* inc r15 */
+    0xf8, /* clc */
+    0xeb /* jmp .ret */
+  };
+  const unsigned char unchanged_template[] = { 0xf9 }; /* stc */
+  const unsigned char zero_template[] = { 0x31, 0xc0 }; /* xor eax, eax */
+  const unsigned char minus_one_template[] = { 0xb0, 0xff, 0xf8 }; /* mov al, 0xff; clc */
+  const unsigned char ret_template[] = {
+    0x41, 0x5b, /* pop r11 */
+    0x5f, /* pop rdi */
+    0x5e, /* pop rsi */
+    0x5a, /* pop rdx */
+    0x59, /* pop rcx */
+    0xc3 /* ret */
+  };
+  const unsigned char* eof_template = NULL;
+  int eof_template_size = 0;
+
+  switch (G_PARAMETERS.eof_behavior) {
+  case EOF_BEHAVIOR_ZERO:
+    /* xor already clears the carry flag */
+    eof_template = zero_template;
+    eof_template_size = sizeof (zero_template);
+    break;
+  case EOF_BEHAVIOR_MINUS_ONE:
+    eof_template = minus_one_template;
+    eof_template_size = sizeof (minus_one_template);
+    break;
+  default:
+    eof_template = unchanged_template;
+    eof_template_size = sizeof (unchanged_template);
+    break;
+  }
+
+  write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, G_PARAMETERS.input_buffer_size, 4);
+  write_to_buf(buf, read_template, sizeof (read_template));
+  write_byte_to_buf(buf, eof_template_size);
+  /* .eof: */
+  write_to_buf(buf, eof_template, eof_template_size);
+  /* .ret: */
+  write_to_buf(buf, ret_template, sizeof (ret_template));
+}
+
+/*
+ * Forgets whatever `state` knew about the byte at `offset`, for when it gets
+ * written behind its back.
+ */
+static void forget_byte(CodeState* state, int offset) {
+  if (state->al_offset == offset) {
+    state->al_valid = 0;
+  }
+  if (state->zf_offset == offset) {
+    state->zf_valid = 0;
+  }
+}
+
+/*
+ * Makes `al` hold the byte at `offset`, loading it only if it doesn't
+ * already.
+ */
+static void write_load_al(IoBuf* buf, CodeState* state, int offset) {
+  if (!state->al_valid || state->al_offset != offset) {
+    write_load_al_at_rbx(buf, offset);
+    state->al_valid = 1;
+    state->al_offset = offset;
+  }
+}
+
+/*
+ * Writes what an [ or ] does before its jump: applies the pending pointer
+ * move, and sets ZF from the current byte unless it already is.
+ *
+ * Both [ and ] can be jumped to from the other one, which only agree on the
+ * flags, so only those are known afterwards.
+ */
+static void write_bracket_test(IoBuf* buf, CodeState* state) {
+  write_move_rbx(buf, state->offset);
+  state->al_offset -= state->offset;
+  state->zf_offset -= state->offset;
+  state->offset = 0;
+
+  if (!state->zf_valid || state->zf_offset) {
+    write_load_al(buf, state, 0);
+    write_test_al(buf);
+  }
+
+  state->al_valid = 0;
+  state->zf_valid = 1;
+  state->zf_offset = 0;
+}
+
+/*
+ * What a block of ops does to one byte, see `find_block_effects()`.
+ */
+typedef struct {
+  /* Relative to where the pointer is before the block */
+  int offset;
+  /* If set, the byte ends up as `value`, otherwise `value` is added to it */
+  int set;
+  int value;
+} CellEffect;
+
+static int is_block_op(OpType type) {
+  switch (type) {
+  case OP_MOVE:
+  case OP_MUTATE:
+  case OP_CLEAR:
+  case OP_SET:
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+/*
+ * Adds up what the ops from `op` on that only move and write bytes, without
+ * reading any, do to every byte, into `cells`, sorted by offset. Such a block
+ * ends right before `*end`, and never goes past `stop_op`, which the code can
+ * be entered at. `*moved` is set to how far it moves the pointer.
+ *
+ * Returns `0` if it writes more than `MAX_BLOCK_CELLS` bytes.
+ */
+static int find_block_effects(
+  const Ops* ops, int op, int stop_op, CellEffect* cells, int* cells_n, int* moved, int* end
+) {
+  CellEffect cell;
+  int offset = 0;
+  int fits = 1;
+  int i = 0;
+  int j = 0;
+
+  *cells_n = 0;
+  for (i = op; i < ops->len && is_block_op(ops->types[i]) && (i == op || i != stop_op); ++i) {
+    if (OP_MOVE == ops->types[i]) {
+      offset += ops->ns[i];
+      continue;
+    }
+
+    cell.offset = offset + (OP_SET == ops->types[i] ? ops->offsets[i] : 0);
+    for (j = *cells_n; j > 0 && cells[j - 1].offset > cell.offset; --j);
+    if (j && cells[j - 1].offset == cell.offset) {
+      --j;
+    } else if (MAX_BLOCK_CELLS == *cells_n) {
+      fits = 0;
+      continue;
+    } else {
+      memmove(cells + j + 1, cells + j, (*cells_n - j) * sizeof (CellEffect));
+      ++*cells_n;
+      cells[j].offset = cell.offset;
+      cells[j].set = 0;
+      cells[j].value = 0;
+    }
+
+    if (OP_MUTATE == ops->types[i]) {
+      cells[j].value += ops->ns[i];
+    } else {
+      cells[j].set = 1;
+      cells[j].value = OP_SET == ops->types[i] ? ops->ns[i] : 0;
+    }
+  }
+
+  *moved = offset;
+  *end = i;
+  return fits;
+}
+
+/*
+ * Picks the windows of `width` bytes of `cells` that are cheaper to write
+ * with vector instructions than one byte at a time, each starting at the
+ * first byte of it that changes, and sets `windows[i]` to the index of that
+ * byte in `cells`.
+ *
+ * The cost counts instructions, an addition to a byte counts twice since it
+ * reads, modifies and writes it. A window loads its bytes, masks out the ones
+ * that are set, adds to them and stores them back, and a window that's all
+ * set is only stored. Its load counts as `VECTOR_LOAD_COST`, since the bytes
+ * were likely just written one at a time, and such writes can't be forwarded
+ * to a wider load, which has to wait for them to be done.
+ *
+ * Returns how many windows there are.
+ */
+static int plan_vector_windows(const CellEffect* cells, int cells_n, int width, int* windows) {
+  /* Using a constant from memory is one more instruction, other than with AVX2 */
+  const int constant_cost = 32 == width ? 1 : 2;
+  int windows_n = 0;
+  int scalar_cost = 0;
+  int vector_cost = 0;
+  int set_n = 0;
+  int has_add = 0;
+  int i = 0;
+  int j = 0;
+
+  while (i < cells_n) {
+    scalar_cost = 0;
+    set_n = 0;
+    has_add = 0;
+    for (j = i; j < cells_n && cells[j].offset < cells[i].offset + width; ++j) {
+      if (cells[j].set) {
+        ++set_n;
+        ++scalar_cost;
+      } else if (cells[j].value & 0xff) {
+        scalar_cost += 2;
+      }
+      if (cells[j].value & 0xff) {
+        has_add = 1;
+      }
+    }
+
+    if (set_n == width) {
+      /* A zeroed or constant register, and the store */
+      vector_cost = 2;
+    } else {
+      vector_cost = VECTOR_LOAD_COST + 1 + (set_n ? constant_cost : 0) + (has_add ? constant_cost : 0);
+    }
+
+    if (vector_cost < scalar_cost) {
+      windows[windows_n++] = i;
+      i = j;
+    } else {
+      ++i;
+    }
+  }
+
+  return windows_n;
+}
+
+/*
+ * A block of straight-line ops, see `find_block_effects()`, and the windows
+ * `plan_vector_windows()` picked for it.
+ */
+typedef struct {
+  CellEffect cells[MAX_BLOCK_CELLS];
+  int cells_n;
+  int windows[MAX_BLOCK_CELLS];
+  int windows_n;
+  /* Of the vectors, 16 bytes with SSE2 or 32 with AVX2 */
+  int width;
+  /* Its first op, and the one right after it */
+  int start;
+  int end;
+  /* How far it moves the pointer */
+  int moved;
+} VectorBlock;
+
+/*
+ * If `op` starts a block of ops that isn't `*block` already, finds it and
+ * its windows, unless it's cold in `heats`. Blocks never go past `stop_op`.
+ *
+ * Returns `1` if it did and there are windows, then `write_block()` writes
+ * the whole block at once.
+ */
+static int plan_vector_block(
+  const Ops* ops, int op, int stop_op, const unsigned char* heats, VectorBlock* block
+) {
+  if (
+    SIMD_EXTENSION_NONE == G_PARAMETERS.simd_extension || !is_block_op(ops->types[op])
+    || (op >= block->start && op < block->end)
+  ) {
+    return 0;
+  }
+
+  block->start = op;
+  block->windows_n = 0;
+  block->width = SIMD_EXTENSION_AVX2 == G_PARAMETERS.simd_extension ? 32 : 16;
+  if (
+    find_block_effects(ops, op, stop_op, block->cells, &block->cells_n, &block->moved, &block->end)
+    && (!heats || PROFILE_HEAT_COLD != heats[op])
+  ) {
+    block->windows_n = plan_vector_windows(block->cells, block->cells_n, block->width, block->windows);
+  }
+
+  return block->windows_n > 0;
+}
+
+/*
+ * Writes `[rip+rel32]` as the r/m operand for `xmm0` or `ymm0` if `reg` is
+ * 0, or for `xmm1`, pointing at the `size` bytes of `constant`, which are
+ * stored after the code.
+ *
+ * Returns `0` if out of memory.
+ */
+static int write_vector_constant_operand(
+  IoBuf* buf, int reg, const unsigned char* constant, int size, IoBuf* rodata, IoBuf* references
+) {
+  write_byte_to_buf(buf, 0x05 | (reg << 3)); /* mod=00 r/m=rip */
+  if (!write_code_reference(buf, references, rodata->size)) {
+    return 0;
+  }
+
+  return write_to_buf(rodata, constant, size);
+}
+
+/*
+ * Writes what the cells of `block` do to the bytes, with the pointer `base`
+ * away from `rbx`: its windows with vector instructions, and the rest one
+ * byte at a time.
+ *
+ * Returns `0` if out of memory.
+ */
+static int write_block(
+  IoBuf* buf, const VectorBlock* block, int base, IoBuf* rodata, IoBuf* references
+) {
+  const CellEffect* cells = block->cells;
+  const int cells_n = block->cells_n;
+  const int* windows = block->windows;
+  const int windows_n = block->windows_n;
+  const int width = block->width;
+  const int avx2 = 32 == width;
+  const unsigned char sse2_load_template[] = { 0xf3, 0x0f, 0x6f }; /* movdqu xmm, ... */
+  const unsigned char sse2_store_template[] = { 0xf3, 0x0f, 0x7f }; /* movdqu ..., xmm */
+  const unsigned char sse2_zero_template[] = { 0x66, 0x0f, 0xef, 0xc0 }; /* pxor xmm0, xmm0 */
+  const unsigned char sse2_and_template[] = { 0x66, 0x0f, 0xdb, 0xc1 }; /* pand xmm0, xmm1 */
+  const unsigned char sse2_add_template[] = { 0x66, 0x0f, 0xfc, 0xc1 }; /* paddb xmm0, xmm1 */
+  const unsigned char avx2_load_template[] = { 0xc5, 0xfe, 0x6f }; /* vmovdqu ymm0, ... */
+  const unsigned char avx2_store_template[] = { 0xc5, 0xfe, 0x7f }; /* vmovdqu ..., ymm0 */
+  const unsigned char avx2_zero_template[] = { 0xc5, 0xfd, 0xef, 0xc0 }; /* vpxor ymm0, ymm0, ymm0 */
+  const unsigned char avx2_and_template[] = { 0xc5, 0xfd, 0xdb }; /* vpand ymm0, ymm0, ... */
+  const unsigned char avx2_add_template[] = { 0xc5, 0xfd, 0xfc }; /* vpaddb ymm0, ymm0, ... */
+  const unsigned char vzeroupper_template[] = { 0xc5, 0xf8, 0x77 };
+  /* Bytes that are kept, and what is added to each, which sets the others */
+  unsigned char keep[32];
+  unsigned char add[32];
+  const unsigned char* load_template = avx2 ? avx2_load_template : sse2_load_template;
+  int start = 0;
+  int set_n = 0;
+  int has_add = 0;
+  int window = 0;
+  int i = 0;
+
+  for (window = 0; window < windows_n; ++window) {
+    start = cells[windows[window]].offset;
+    memset(keep, 0xff, sizeof (keep));
+    memset(add, 0, sizeof (add));
+    set_n = 0;
+    has_add = 0;
+    for (i = windows[window]; i < cells_n && cells[i].offset < start + width; ++i) {
+      if (cells[i].set) {
+        keep[cells[i].offset - start] = 0;
+        ++set_n;
+      }
+      add[cells[i].offset - start] = cells[i].value;
+      has_add |= cells[i].value & 0xff;
+    }
+
+    if (set_n == width && !has_add) {
+      if (avx2) {
+        write_to_buf(buf, avx2_zero_template, sizeof (avx2_zero_template));
+      } else {
+        write_to_buf(buf, sse2_zero_template, sizeof (sse2_zero_template));
+      }
+    } else if (set_n == width) {
+      write_to_buf(buf, load_template, 3);
+      if (!write_vector_constant_operand(buf, 0, add, width, rodata, references)) {
+        return 0;
+      }
+    } else {
+      write_to_buf(buf, load_template, 3);
+      write_rbx_offset_operand(buf, 0, base + start);
+
+      if (set_n && avx2) {
+        write_to_buf(buf, avx2_and_template, sizeof (avx2_and_template));
+      } else if (set_n) {
+        write_to_buf(buf, sse2_load_template, sizeof (sse2_load_template));
+      }
+      if (set_n && !write_vector_constant_operand(buf, !avx2, keep, width, rodata, references)) {
+        return 0;
+      }
+      if (set_n && !avx2) {
+        write_to_buf(buf, sse2_and_template, sizeof (sse2_and_template));
+      }
+
+      if (has_add && avx2) {
+        write_to_buf(buf, avx2_add_template, sizeof (avx2_add_template));
+      } else if (has_add) {
+        write_to_buf(buf, sse2_load_template, sizeof (sse2_load_template));
+      }
+      if (has_add && !write_vector_constant_operand(buf, !avx2, add, width, rodata, references)) {
+        return 0;
+      }
+      if (has_add && !avx2) {
+        write_to_buf(buf, sse2_add_template, sizeof (sse2_add_template));
+      }
+    }
+
+    if (avx2) {
+      write_to_buf(buf, avx2_store_template, sizeof (avx2_store_template));
+    } else {
+      write_to_buf(buf, sse2_store_template, sizeof (sse2_store_template));
+    }
+    write_rbx_offset_operand(buf, 0, base + start);
+  }
+  if (avx2 && windows_n) {
+    write_to_buf(buf, vzeroupper_template, sizeof (vzeroupper_template));
+  }
+
+  /* The bytes in between the windows */
+  window = 0;
+  for (i = 0; i < cells_n; ++i) {
+    while (window < windows_n && cells[i].offset >= cells[windows[window]].offset + width) {
+      ++window;
+    }
+    if (window < windows_n && i >= windows[window]) {
+      continue;
+    }
+
+    if (cells[i].set) {
+      write_set_at_rbx(buf, base + cells[i].offset, cells[i].value);
+    } else if (cells[i].value & 0xff) {
+      write_add_imm8_at_rbx(buf, base + cells[i].offset, cells[i].value);
+    }
+  }
+
+  return 1;
+}
+
+/*
+ * Writes the code of `op` to `buf`, other than [ and ], which are left for
+ * `write_bracket_test()` and `relax_bracket_jumps()`.
+ *
+ * `heat` is the `ProfileHeat` of `op`, cold code is kept small.
+ */
+static void write_op_code(const Ops* ops, int op, int heat, IoBuf* buf, CodeState* state) {
+  const int offset = state->offset;
+  const int n = ops->ns[op];
+  int i = 0;
+
+  switch (ops->types[op]) {
+  case OP_MOVE:
+    state->offset += n;
+    break;
+  
+  case OP_MUTATE:
+    if (state->al_valid && state->al_offset == offset) {
+      write_add_imm8_to_al(buf, n);
+      write_store_al_at_rbx(buf, offset);
+    } else {
+      write_add_imm8_at_rbx(buf, offset, n);
+    }
+    state->zf_valid = 1;
+    state->zf_offset = offset;
+    break;
+
+  case OP_PRINT:
+    write_load_al(buf, state, offset);
+    write_print(buf, n);
+    state->zf_valid = 0;
+    break;
+
+  case OP_INPUT:
+    /* The refill routine flushes the output before it can block on input */
+    for (i = 0; i < n; ++i) {
+      write_input(buf, offset);
+    }
+    /* On EOF, al might not be what was left in the byte */
+    state->al_valid = EOF_BEHAVIOR_UNCHANGED != G_PARAMETERS.eof_behavior;
+    state->al_offset = offset;
+    state->zf_valid = 0;
+    break;
+
+  case OP_CLEAR:
+    write_set_at_rbx(buf, offset, 0);
+    forget_byte(state, offset);
+    break;
+
+  case OP_SET:
+    write_set_at_rbx(buf, offset + ops->offsets[op], n);
+    forget_byte(state, offset + ops->offsets[op]);
+    break;
+
+  case OP_PRINT_CONST:
+    write_print_const(buf, ops->offsets[op], n);
+    state->zf_valid = 0;
+    break;
+
+  case OP_MUL_ADD:
+    write_load_al(buf, state, offset);
+    write_mul_add(buf, offset + ops->offsets[op], n);
+    state->zf_valid = 1;
+    state->zf_offset = offset + ops->offsets[op];
+    break;
+
+  case OP_CMP_ADD:
+    if (!state->zf_valid || state->zf_offset != offset) {
+      write_byte_to_buf(buf, 0x80); /* cmp byte [rbx+offset], 0 */
+      write_rbx_offset_operand(buf, 7, offset);
+      write_byte_to_buf(buf, 0);
+    }
+    write_setne_add(buf, offset + ops->offsets[op], n);
+    state->al_valid = 0;
+    state->zf_valid = 1;
+    state->zf_offset = offset + ops->offsets[op];
+    break;
+
+  case OP_DIVMOD:
+    /* What's left of it once `write_divmod()` didn't skip the loop */
+    write_add_imm8_at_rbx(buf, offset, -1);
+    forget_byte(state, offset);
+    state->zf_valid = 1;
+    state->zf_offset = offset;
+    break;
+
+  case OP_SCAN:
+    write_scan(buf, offset, n, PROFILE_HEAT_COLD == heat);
+    state->offset = 0;
+    state->al_valid = 0;
+    state->zf_valid = 0;
+    break;
+
+  case OP_IF_NOT_0:
+  case OP_IF_0:
+  default:
+    assert(0); /* Not made for this */
+    break;
+  }
+}
+
+/*
+ * Picks the size of every bracket jump in `jumps`, and makes room for the
+ * near ones in `buf`, moving the code after them, and writes all of them.
+ *
+ * A jump can only be short if where it jumps is within reach, which depends
+ * on the sizes of the jumps in between, so all start short and the ones that
+ * don't reach are made near until none changes. Jumps only ever grow, so it
+ * always ends.
+ */
+static void relax_bracket_jumps(IoBuf* buf, BracketJump* jumps, int jumps_n) {
+  int near_n = 0;
+  int changed = 1;
+  int rel = 0;
+  int shift = 0;
+  int end = buf->size;
+  int start = 0;
+  int i = 0;
+
+  while (changed) {
+    changed = 0;
+
+    shift = 0;
+    for (i = 0; i < jumps_n; ++i) {
+      jumps[i].end = jumps[i].position + shift + IF_JUMP_SIZE_SHORT;
+      if (jumps[i].is_near) {
+        jumps[i].end += IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT;
+        shift += IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT;
+      }
+    }
+
+    for (i = 0; i < jumps_n; ++i) {
+      rel = jumps[jumps[i].match].end - jumps[i].end;
+      if (!jumps[i].is_near && (rel < -128 || rel > 127)) {
+        jumps[i].is_near = 1;
+        ++near_n;
+        changed = 1;
+      }
+    }
+  }
+
+  /* Moves everything back to front, so nothing is overwritten before it's moved */
+  shift = near_n * (IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT);
+  for (i = 0; i < shift; ++i) {
+    write_byte_to_buf(buf, 0);
+  }
+  for (i = jumps_n - 1; i >= 0; --i) {
+    start = jumps[i].position + IF_JUMP_SIZE_SHORT;
+    memmove(buf->ptr + start + shift, buf->ptr + start, end - start);
+
+    if (jumps[i].is_near) {
+      shift -= IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT;
+    }
+    put_bracket_jump(
+      buf->ptr + jumps[i].position + shift, jumps[i].type, jumps[i].is_near,
+      jumps[jumps[i].match].end - jumps[i].end
+    );
+
+    end = jumps[i].position;
+  }
+
+  assert(!shift);
+}
+
+/*
+ * Returns where the code that was at `position` is after
+ * `relax_bracket_jumps()`.
+ */
+static int relaxed_position(const BracketJump* jumps, int jumps_n, int position) {
+  int shift = 0;
+  int i = 0;
+
+  for (i = 0; i < jumps_n && jumps[i].position < position; ++i) {
+    if (jumps[i].is_near) {
+      shift += IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT;
+    }
+  }
+
+  return position + shift;
+}
+
+/*
+ * Writes a `jmp rel32`, with the `rel32` left to be patched.
+ *
+ * Returns the offset of its `rel32`.
+ */
+static int write_jmp_near_imm32(IoBuf* buf) {
+  write_byte_to_buf(buf, 0xe9);
+  write_le_to_buf(buf, 0, 4);
+
+  return buf->size - 4;
+}
+
+/*
+ * Records the jump of a bracket of `type` in `jumps_buf`, see `BracketJump`,
+ * and writes its short placeholder to `buf`.
+ *
+ * On success, returns `1`.
+ */
+static int write_bracket_jump_placeholder(IoBuf* buf, IoBuf* jumps_buf, OpType type, int match) {
+  BracketJump jump;
+
+  jump.position = buf->size;
+  jump.match = match;
+  jump.type = type;
+  jump.is_near = 0;
+  jump.end = 0;
+
+  return write_to_buf(jumps_buf, &jump, sizeof (jump))
+    && write_le_to_buf(buf, 0, IF_JUMP_SIZE_SHORT);
+}
+
+/*
+ * Returns if the loop of the [ `op` is worth writing its body twice, with a
+ * test in between, which takes half the jumps back: it must be hot, short,
+ * and have no loop inside it.
+ */
+static int should_unroll(const Ops* ops, const unsigned char* heats, int op) {
+  int i = 0;
+
+  if (PROFILE_HEAT_HOT != heats[op] || ops->matches[op] - op - 1 > MAX_UNROLLED_OPS) {
+    return 0;
+  }
+  for (i = op + 1; i < ops->matches[op]; ++i) {
+    if (OP_IF_0 == ops->types[i]) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+ * Finds the run of prints of known bytes that starts at `op`, printed at once
+ * by its last print, with `*size` set to how many bytes that is. Runs never
+ * go past `stop_op`, which the code can be entered at.
+ *
+ * Ops in between can only move the pointer, or write the tape if it's
+ * `static_tape`, since one that makes the program fail must not see the
+ * output of the prints before it held back.
+ *
+ * Returns its last op, or `-1` if it isn't worth it.
+ */
+static int find_printed_string(const Ops* ops, int op, int stop_op, int static_tape, int* size) {
+  int last = -1;
+  int i = 0;
 
-void assemble_x86_64(Assembler* self, AssemblerResult* result);
-const Assembler G_X86_64_ASSEMBLER_TEMPLATE = {
-  .ops = NULL,
-  .optimization_info = {0},
-  .assemble = assemble_x86_64
-};
+  *size = 0;
+  for (i = op; i < ops->len && (i == op || i != stop_op); ++i) {
+    switch (ops->types[i]) {
+    case OP_PRINT_CONST:
+      *size += ops->ns[i];
+      last = i;
+      continue;
 
-static void write_add_imm8_at_rsp(IoBuf* buf, int imm) {
-  const char template[] = { 0x80, 0x04, 0x24 };
+    case OP_MOVE:
+      continue;
 
-  write_to_buf(buf, template, sizeof (template));
-  write_byte_to_buf(buf, imm);
-}
+    case OP_MUTATE:
+    case OP_CLEAR:
+    case OP_SET:
+    case OP_MUL_ADD:
+      if (static_tape) {
+        continue;
+      }
+      break;
 
-static void write_add_imm32_to_rsp(IoBuf* buf, int imm) {
-  const char template[] = { 0x48, 0x81, 0xc4 };
+    default:
+      break;
+    }
+    break;
+  }
 
-  /* TODO: Make it cross platform with endianess changes and use int32 */
-  assert(sizeof (imm) == 4);
-  write_to_buf(buf, template, sizeof (template));
-  write_to_buf(buf, &imm, 4);
+  return *size >= MIN_PRINTED_STRING_SIZE ? last : -1;
 }
 
-static void write_jz_near_imm32(IoBuf* buf, int imm) {
-  const char template[] = { 0x0f, 0x84 };
+/*
+ * Stores the bytes that the run of prints from `start` to `end`, see
+ * `find_printed_string()`, prints in `rodata`, and writes a print of all
+ * `size` of them at once, which also flushes if the output is line buffered
+ * and they have a newline.
+ *
+ * Returns `0` if out of memory.
+ */
+static int write_printed_string(
+  const Ops* ops, int start, int end, int size, IoBuf* buf, IoBuf* rodata, IoBuf* references
+) {
+  const int offset = rodata->size;
+  int i = 0;
+  int j = 0;
+
+  for (i = start; i <= end; ++i) {
+    for (j = 0; OP_PRINT_CONST == ops->types[i] && j < ops->ns[i]; ++j) {
+      if (!write_byte_to_buf(rodata, ops->offsets[i])) {
+        return 0;
+      }
+    }
+  }
+  if (!write_print_string(buf, references, offset, size)) {
+    return 0;
+  }
+  if (G_PARAMETERS.line_buffered && memchr(rodata->ptr + offset, '\n', size)) {
+    write_call_flush(buf);
+  }
 
-  assert(sizeof (imm) == 4);
-  write_to_buf(buf, template, sizeof (template));
-  /* TODO: Make it cross platform with endianess changes and use int32 */
-  write_to_buf(buf, &imm, 4);
+  return 1;
 }
 
-static void write_jz_short_imm8(IoBuf* buf, int imm) {
-  write_byte_to_buf(buf, 0x74);
-  write_byte_to_buf(buf, imm);
-}
+/*
+ * Returns how many loops start before `end_op`, which is the index of the
+ * record of the next one in the profile block.
+ */
+static int count_loops(const Ops* ops, int end_op) {
+  int loops_n = 0;
+  int op = 0;
 
-static void write_jnz_near_imm32(IoBuf* buf, int imm) {
-  const char template[] = { 0x0f, 0x85 };
+  for (op = 0; op < end_op && op < ops->len; ++op) {
+    if (OP_IF_0 == ops->types[op]) {
+      ++loops_n;
+    }
+  }
 
-  assert(sizeof (imm) == 4);
-  write_to_buf(buf, template, sizeof (template));
-  /* TODO: Make it cross platform with endianess changes and use int32 */
-  write_to_buf(buf, &imm, 4);
+  return loops_n;
 }
 
-static void write_jnz_short_imm8(IoBuf* buf, int imm) {
-  write_byte_to_buf(buf, 0x75);
-  write_byte_to_buf(buf, imm);
+/*
+ * Writes the profile block to `initial_data`, which must be empty: a record
+ * for every loop of `ops` with 0 counts, followed by `path`.
+ *
+ * Returns its size, or `0` if out of memory.
+ */
+static int write_profile_block(const Ops* ops, const char* path, IoBuf* initial_data) {
+  const int loops_n = count_loops(ops, ops->len);
+  int op = 0;
+
+  assert(!initial_data->size);
+
+  if (
+    !write_to_buf(initial_data, PROFILE_MAGIC, strlen(PROFILE_MAGIC))
+    || !write_le_to_buf(initial_data, loops_n, PROFILE_HEADER_SIZE - strlen(PROFILE_MAGIC))
+  ) {
+    return 0;
+  }
+  for (op = 0; op < ops->len; ++op) {
+    if (
+      OP_IF_0 == ops->types[op]
+      && (
+        !write_le_to_buf(initial_data, ops->spans[op].src_start, 4)
+        || !write_le_to_buf(initial_data, ops->spans[ops->matches[op]].src_end, 4)
+        || !write_le_to_buf(initial_data, 0, 8)
+        || !write_le_to_buf(initial_data, 0, 8)
+      )
+    ) {
+      return 0;
+    }
+  }
+  if (!write_to_buf(initial_data, path, strlen(path) + 1)) {
+    return 0;
+  }
+
+  return initial_data->size;
 }
 
-static void write_test_at_sp(IoBuf* buf) {
-  const char template[] = {
-    0x8a, 0x04, 0x24, /* mov al, [rsp] */
-    0x84, 0xc0 /* test al, al */
-  };
+/*
+ * Points `r9` at the profile block, `output_offset` bytes before the output
+ * buffer.
+ *
+ * Asserts `r12` is at the output buffer.
+ */
+static void write_lea_profile_to_r9(IoBuf* buf, int output_offset) {
+  const unsigned char template[] = { 0x4d, 0x8d, 0x8c, 0x24 }; /* lea r9, [r12+imm32] */
 
   write_to_buf(buf, template, sizeof (template));
+  write_le_to_buf(buf, -output_offset, 4);
 }
 
-static void write_read_syscall(IoBuf* buf) {
-  const char template[] = {
-    0x48, 0x31, 0xc0, /* xor rax, rax */
-    0x48, 0x31, 0xff, /* xor rdi, rdi */
-    0x48, 0x89, 0xe6, /* mov rsi, rsp */
-    0xba, 0x01, 0x00, 0x00, 0x00, /* mov rdx, 1 */
-    0x0f, 0x05 /* syscall */
-  };
+/*
+ * Counts one more in the count at `count_offset` of the record of the
+ * `loop`th loop in the profile block, with an `inc`, so it sets ZF.
+ */
+static void write_inc_profile_count(IoBuf* buf, int loop, int count_offset) {
+  const unsigned char template[] = { 0x49, 0xff }; /* inc qword [r9+offset] */
+  const int offset = PROFILE_HEADER_SIZE + loop * PROFILE_RECORD_SIZE + count_offset;
 
   write_to_buf(buf, template, sizeof (template));
+  if (offset < 128) {
+    write_byte_to_buf(buf, 0x41);
+    write_byte_to_buf(buf, offset);
+  } else {
+    write_byte_to_buf(buf, 0x81);
+    write_le_to_buf(buf, offset, 4);
+  }
 }
 
-static void write_write_syscall(IoBuf* buf) {
-  const char template[] = {
-    0xb8, 0x01, 0x00, 0x00, 0x00, /* mov rax, 1 */
-    0xbf, 0x01, 0x00, 0x00, 0x00, /* mov rdi, 1 */
-    0x48, 0x89, 0xe6, /* mov rsi, rsp */
-    0xba, 0x01, 0x00, 0x00, 0x00, /* mov rdx, 1 */
+/*
+ * Writes the records of the profile block of `profile_size` bytes to `path`,
+ * which comes right after them and isn't part of the profile, replacing the
+ * file. Nothing is written if the file can't be opened, the program still
+ * succeeds.
+ *
+ * Clobbers `rax`, `rcx`, `rdx`, `rsi`, `rdi` and `r11`.
+ */
+static void write_profile_dump(IoBuf* buf, int profile_size, const char* path) {
+  const unsigned char open_template[] = {
+    0xb8, 0x02, 0x00, 0x00, 0x00, /* mov eax, 2 */
+    0x49, 0x8d, 0xb9 /* lea rdi, [r9+imm32] */
+  };
+  const unsigned char write_template[] = {
+    0xbe, 0x41, 0x02, 0x00, 0x00, /* mov esi, O_WRONLY | O_CREAT | O_TRUNC */
+    0xba, 0xa4, 0x01, 0x00, 0x00, /* mov edx, 0644 */
+    0x0f, 0x05, /* syscall */
+    0x85, 0xc0, /* test eax, eax */
+    0x78, 0x18, /* js .done */
+    0x89, 0xc7, /* mov edi, eax */
+    0xb8, 0x01, 0x00, 0x00, 0x00, /* mov eax, 1 */
+    0x4c, 0x89, 0xce, /* mov rsi, r9 */
+    0xba /* mov edx, imm32 */
+  };
+  const unsigned char close_template[] = {
+    0x0f, 0x05, /* syscall */
+    0xb8, 0x03, 0x00, 0x00, 0x00, /* mov eax, 3 */
     0x0f, 0x05 /* syscall */
+    /* .done: */
   };
+  const int records_size = profile_size - (strlen(path) + 1);
 
-  write_to_buf(buf, template, sizeof (template));
+  write_to_buf(buf, open_template, sizeof (open_template));
+  write_le_to_buf(buf, records_size, 4);
+  write_to_buf(buf, write_template, sizeof (write_template));
+  write_le_to_buf(buf, records_size, 4);
+  write_to_buf(buf, close_template, sizeof (close_template));
 }
 
-static void write_exit_success_syscall(IoBuf* buf) {
-  const char template[] = {
-    0xb8, 0x3c, 0x00, 0x00, 0x00, /* mov rax, 0x3c */
-    0x48, 0x31, 0xff, /* xor rdi, rdi */
-    0x0f, 0x05 /* syscall */
+/*
+ * Returns how many bytes the tape mapping takes, its guard areas included,
+ * and sets `*inner_size` to how many of them are accessible.
+ */
+static unsigned long get_tape_mapping_size(unsigned long* inner_size) {
+  *inner_size = ((unsigned long)G_PARAMETERS.max_tape_size + TAPE_PADDING + PAGE_SIZE - 1)
+    & ~(unsigned long)(PAGE_SIZE - 1);
+  return TAPE_GUARD_SIZE + *inner_size + TAPE_GUARD_SIZE;
+}
+
+/*
+ * Maps the tape: `G_PARAMETERS.max_tape_size` cells and the padding after
+ * them, between guard areas that make any access fault, so the SIGSEGV
+ * handler it installs can stop the program with an error. The kernel only
+ * backs the pages the program touches, so the tape grows as it goes, and
+ * reserving it all up front costs nothing but address space.
+ *
+ * Points `rbx` at the first cell, and copies the `image_size` bytes right
+ * before the output buffer there. Exits with failure if the tape can't be
+ * mapped.
+ *
+ * Sets `*handler_rel_offset` and `*restorer_rel_offset` to the offsets of
+ * the `rel32`s that must later point at the handler and its restorer.
+ *
+ * Asserts `r12` and `r13` are set. Clobbers `rax`, `rcx`, `rdx`, `rsi`,
+ * `rdi`, `r8`, `r9`, `r10` and `r11`.
+ */
+static void write_tape_setup(
+  IoBuf* buf, int image_size, int callable, int* handler_rel_offset, int* restorer_rel_offset
+) {
+  const unsigned char mmap_template[] = {
+    0xb8, 0x09, 0x00, 0x00, 0x00, /* mov eax, 9 */
+    0x31, 0xff, /* xor edi, edi */
+    0x31, 0xd2, /* xor edx, edx */
+    0x41, 0xba, 0x22, 0x40, 0x00, 0x00, /* mov r10d, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE */
+    0x49, 0xc7, 0xc0, 0xff, 0xff, 0xff, 0xff, /* mov r8, -1 */
+    0x45, 0x31, 0xc9, /* xor r9d, r9d */
+    0x48, 0xbe /* mov rsi, imm64 */
+  };
+  const unsigned char mmap_check_template[] = {
+    0x0f, 0x05, /* syscall */
+    0x48, 0x3d, 0x01, 0xf0, 0xff, 0xff, /* cmp rax, -4095 */
+    0x73 /* jae .fail */
+  };
+  const unsigned char save_mapping_template[] = { 0x49, 0x89, 0x85 }; /* mov [r13+imm32], rax */
+  const unsigned char mprotect_template[] = { 0x48, 0x8d, 0xb8 }; /* lea rdi, [rax+imm32] */
+  const unsigned char mprotect_size_template[] = { 0x48, 0xbe }; /* mov rsi, imm64 */
+  const unsigned char mprotect_call_template[] = {
+    0xba, 0x03, 0x00, 0x00, 0x00, /* mov edx, PROT_READ | PROT_WRITE */
+    0xb8, 0x0a, 0x00, 0x00, 0x00, /* mov eax, 10 */
+    0x0f, 0x05, /* syscall */
+    0x48, 0x85, 0xc0, /* test rax, rax */
+    0x75 /* jnz .fail */
+  };
+  const unsigned char mov_rbx_template[] = { 0x48, 0x89, 0xfb }; /* mov rbx, rdi */
+  const unsigned char prefault_template[] = {
+    /* rdi and rsi still hold the accessible part */
+    0xb8, 0x1c, 0x00, 0x00, 0x00, /* mov eax, 28 */
+    0xba, 0x0e, 0x00, 0x00, 0x00, /* mov edx, MADV_HUGEPAGE */
+    0x0f, 0x05, /* syscall */
+    0x48, 0x89, 0xdf, /* mov rdi, rbx */
+    0xb9 /* mov ecx, imm32 */
+  };
+  const unsigned char touch_template[] = {
+    /* .touch: */
+    0xc6, 0x07, 0x00, /* mov byte [rdi], 0 */
+    0x48, 0x81, 0xc7, 0x00, 0x10, 0x00, 0x00, /* add rdi, PAGE_SIZE */
+    0xff, 0xc9, /* dec ecx */
+    0x75, 0xf2 /* jnz .touch */
+  };
+  const unsigned char image_template[] = { 0x49, 0x8d, 0xb4, 0x24 }; /* lea rsi, [r12+imm32] */
+  const unsigned char image_copy_template[] = {
+    0x48, 0x89, 0xdf, /* mov rdi, rbx */
+    0xb9 /* mov ecx, imm32 */
   };
+  const unsigned char rep_movsb_template[] = { 0xf3, 0xa4 };
+  const unsigned char lea_handler_template[] = { 0x48, 0x8d, 0x05 }; /* lea rax, [rip+imm32] */
+  const unsigned char lea_restorer_template[] = { 0x48, 0x8d, 0x0d }; /* lea rcx, [rip+imm32] */
+  const unsigned char sigaction_template[] = {
+    0x6a, 0x00, /* push 0 ; sa_mask */
+    0x51, /* push rcx ; sa_restorer */
+    0x68, 0x04, 0x00, 0x00, 0x04, /* push SA_SIGINFO | SA_RESTORER */
+    0x50, /* push rax ; sa_handler */
+    0xb8, 0x0d, 0x00, 0x00, 0x00, /* mov eax, 13 */
+    0xbf, 0x0b, 0x00, 0x00, 0x00, /* mov edi, SIGSEGV */
+    0x48, 0x89, 0xe6 /* mov rsi, rsp */
+  };
+  const unsigned char old_sigaction_template[] = { 0x49, 0x8d, 0x95 }; /* lea rdx, [r13+imm32] */
+  const unsigned char no_old_sigaction_template[] = { 0x31, 0xd2 }; /* xor edx, edx */
+  const unsigned char sigaction_call_template[] = {
+    0x41, 0xba, 0x08, 0x00, 0x00, 0x00, /* mov r10d, 8 */
+    0x0f, 0x05, /* syscall */
+    0x48, 0x83, 0xc4, 0x20, /* add rsp, 32 */
+    0xeb /* jmp .done */
+  };
+  unsigned long inner_size = 0;
+  const unsigned long mapping_size = get_tape_mapping_size(&inner_size);
+  int mmap_fail_offset = 0;
+  int mprotect_fail_offset = 0;
+  int done_offset = 0;
 
-  write_to_buf(buf, template, sizeof (template));
+  write_to_buf(buf, mmap_template, sizeof (mmap_template));
+  write_le_to_buf(buf, mapping_size, 8);
+  write_to_buf(buf, mmap_check_template, sizeof (mmap_check_template));
+  mmap_fail_offset = buf->size;
+  write_byte_to_buf(buf, 0);
+  if (callable) {
+    write_to_buf(buf, save_mapping_template, sizeof (save_mapping_template));
+    write_le_to_buf(buf, G_PARAMETERS.input_buffer_size + TAPE_MAPPING_SLOT, 4);
+  }
+
+  write_to_buf(buf, mprotect_template, sizeof (mprotect_template));
+  write_le_to_buf(buf, TAPE_GUARD_SIZE, 4);
+  write_to_buf(buf, mprotect_size_template, sizeof (mprotect_size_template));
+  write_le_to_buf(buf, inner_size, 8);
+  write_to_buf(buf, mprotect_call_template, sizeof (mprotect_call_template));
+  mprotect_fail_offset = buf->size;
+  write_byte_to_buf(buf, 0);
+  write_to_buf(buf, mov_rbx_template, sizeof (mov_rbx_template));
+
+  if (G_PARAMETERS.prefault_tape) {
+    /* Any page the tape starts in is touched, but none past tape_size */
+    write_to_buf(buf, prefault_template, sizeof (prefault_template));
+    write_le_to_buf(buf, (G_PARAMETERS.tape_size + PAGE_SIZE - 1) / PAGE_SIZE, 4);
+    write_to_buf(buf, touch_template, sizeof (touch_template));
+  }
+
+  if (image_size) {
+    write_to_buf(buf, image_template, sizeof (image_template));
+    write_le_to_buf(buf, -image_size, 4);
+    write_to_buf(buf, image_copy_template, sizeof (image_copy_template));
+    write_le_to_buf(buf, image_size, 4);
+    write_to_buf(buf, rep_movsb_template, sizeof (rep_movsb_template));
+  }
+
+  write_to_buf(buf, lea_handler_template, sizeof (lea_handler_template));
+  write_le_to_buf(buf, 0, 4);
+  *handler_rel_offset = buf->size - 4;
+  write_to_buf(buf, lea_restorer_template, sizeof (lea_restorer_template));
+  write_le_to_buf(buf, 0, 4);
+  *restorer_rel_offset = buf->size - 4;
+  write_to_buf(buf, sigaction_template, sizeof (sigaction_template));
+  if (callable) {
+    write_to_buf(buf, old_sigaction_template, sizeof (old_sigaction_template));
+    write_le_to_buf(buf, G_PARAMETERS.input_buffer_size + OLD_SIGACTION_SLOT, 4);
+  } else {
+    write_to_buf(buf, no_old_sigaction_template, sizeof (no_old_sigaction_template));
+  }
+  write_to_buf(buf, sigaction_call_template, sizeof (sigaction_call_template));
+  done_offset = buf->size;
+  write_byte_to_buf(buf, 0);
+
+  /* .fail: */
+  patch_rel8_to_end(buf, mmap_fail_offset);
+  patch_rel8_to_end(buf, mprotect_fail_offset);
+  write_exit_fail_syscall(buf);
+  /* .done: */
+  patch_rel8_to_end(buf, done_offset);
 }
 
-static void write_exit_fail_syscall(IoBuf* buf) {
-  const char template[] = {
-    0xb8, 0x3c, 0x00, 0x00, 0x00, /* mov rax, 0x3c */
-    0xbf, 0x01, 0x00, 0x00, 0x00, /* mov rdi, 1 */
-    0x0f, 0x05 /* syscall */
+/*
+ * Undoes `write_tape_setup()` for a callable program, which leaves the
+ * process it runs in as it found it.
+ *
+ * Clobbers `rax`, `rcx`, `rdx`, `rsi`, `rdi`, `r10` and `r11`.
+ */
+static void write_tape_teardown(IoBuf* buf) {
+  const unsigned char sigaction_template[] = {
+    0xb8, 0x0d, 0x00, 0x00, 0x00, /* mov eax, 13 */
+    0xbf, 0x0b, 0x00, 0x00, 0x00, /* mov edi, SIGSEGV */
+    0x49, 0x8d, 0xb5 /* lea rsi, [r13+imm32] */
+  };
+  const unsigned char sigaction_call_template[] = {
+    0x31, 0xd2, /* xor edx, edx */
+    0x41, 0xba, 0x08, 0x00, 0x00, 0x00, /* mov r10d, 8 */
+    0x0f, 0x05, /* syscall */
+    0xb8, 0x0b, 0x00, 0x00, 0x00, /* mov eax, 11 */
+    0x49, 0x8b, 0xbd /* mov rdi, [r13+imm32] */
   };
+  const unsigned char munmap_template[] = { 0x48, 0xbe }; /* mov rsi, imm64 */
+  const unsigned char syscall_template[] = { 0x0f, 0x05 };
+  unsigned long inner_size = 0;
 
-  write_to_buf(buf, template, sizeof (template));
+  write_to_buf(buf, sigaction_template, sizeof (sigaction_template));
+  write_le_to_buf(buf, G_PARAMETERS.input_buffer_size + OLD_SIGACTION_SLOT, 4);
+  write_to_buf(buf, sigaction_call_template, sizeof (sigaction_call_template));
+  write_le_to_buf(buf, G_PARAMETERS.input_buffer_size + TAPE_MAPPING_SLOT, 4);
+  write_to_buf(buf, munmap_template, sizeof (munmap_template));
+  write_le_to_buf(buf, get_tape_mapping_size(&inner_size), 8);
+  write_to_buf(buf, syscall_template, sizeof (syscall_template));
+}
+
+/*
+ * Notes the line of `op`, whose code starts at `position`, in `table`.
+ *
+ * On success, returns `1`.
+ */
+static int add_line_entry(LineTable* table, const Source* src, const Ops* ops, int op, int position) {
+  const int src_start = ops->spans[op].src_start;
+
+  if (src_start < table->text_i) {
+    /* Ops only go back in the source in an unrolled loop's second copy */
+    table->text_i = 0;
+    table->line = 1;
+  }
+  for (; table->text_i < src_start && table->text_i < src->len; ++table->text_i) {
+    if ('\n' == src->text[table->text_i]) {
+      ++table->line;
+    }
+  }
+
+  if (table->line == table->last_line) {
+    return 1;
+  }
+  table->last_line = table->line;
+
+  return write_to_buf(&table->entries, &position, sizeof (int))
+    && write_to_buf(&table->entries, &table->line, sizeof (int));
 }
 
-static void write_op_code(Op* op) {
+/*
+ * Writes the SIGSEGV handler, which only ever runs when the pointer left the
+ * tape: it flushes the output, prints an error with the line of the code
+ * that faulted like `bfc` would, and exits with failure. Then writes the
+ * restorer the kernel requires along with it, the entries of `table` with
+ * their offsets moved past `jumps`, and the message.
+ *
+ * Points the `rel32`s at `handler_rel_offset` and `restorer_rel_offset`,
+ * which `write_tape_setup()` left, at the handler and its restorer.
+ */
+static void write_segv_handler(
+  IoBuf* buf, const Source* src, const LineTable* table, const BracketJump* jumps, int jumps_n,
+  int handler_rel_offset, int restorer_rel_offset
+) {
+  const char error_prefix[] = "ERROR: ";
+  const char error_suffix[] = ": Pointer went out of the tape!\n";
+  const unsigned char rip_template[] = {
+    0x41, 0xff, 0xd6, /* call r14 */
+    0x48, 0x8b, 0x82, 0xa8, 0x00, 0x00, 0x00, /* mov rax, [rdx+REG_RIP] ; of the ucontext */
+    0x48, 0x8d, 0x0d /* lea rcx, [rip+imm32] ; start of the code */
+  };
+  const unsigned char lines_template[] = {
+    0x48, 0x29, 0xc8, /* sub rax, rcx */
+    0x48, 0x8d, 0x35 /* lea rsi, [rip+imm32] */
+  };
+  const unsigned char find_template[] = {
+    0x31, 0xd2, /* xor edx, edx */
+    0xb9 /* mov ecx, imm32 */
+  };
+  const unsigned char find_loop_template[] = {
+    0x85, 0xc9, /* test ecx, ecx */
+    0x74, 0x0f, /* jz .print */
+    /* .find: */
+    0x3b, 0x06, /* cmp eax, [rsi] */
+    0x72, 0x0b, /* jb .print */
+    0x8b, 0x56, 0x04, /* mov edx, [rsi+4] */
+    0x48, 0x83, 0xc6, 0x08, /* add rsi, 8 */
+    0xff, 0xc9, /* dec ecx */
+    0x75, 0xf1, /* jnz .find */
+    /* .print: */
+    0x52, /* push rdx */
+    0x48, 0x8d, 0x35 /* lea rsi, [rip+imm32] */
+  };
+  const unsigned char write_template[] = {
+    0xb8, 0x01, 0x00, 0x00, 0x00, /* mov eax, 1 */
+    0xbf, 0x02, 0x00, 0x00, 0x00, /* mov edi, 2 */
+    0x0f, 0x05 /* syscall */
+  };
+  const unsigned char line_template[] = {
+    0x58, /* pop rax */
+    0x48, 0x89, 0xe6, /* mov rsi, rsp */
+    0xb9, 0x0a, 0x00, 0x00, 0x00, /* mov ecx, 10 */
+    /* .digit: */
+    0x31, 0xd2, /* xor edx, edx */
+    0xf7, 0xf1, /* div ecx */
+    0x80, 0xc2, 0x30, /* add dl, '0' */
+    0x48, 0xff, 0xce, /* dec rsi */
+    0x88, 0x16, /* mov [rsi], dl */
+    0x85, 0xc0, /* test eax, eax */
+    0x75, 0xf0, /* jnz .digit */
+    0x48, 0x89, 0xe2, /* mov rdx, rsp */
+    0x48, 0x29, 0xf2 /* sub rdx, rsi */
+  };
+  const unsigned char suffix_template[] = { 0x48, 0x8d, 0x35 }; /* lea rsi, [rip+imm32] */
+  const unsigned char restorer_template[] = {
+    0xb8, 0x0f, 0x00, 0x00, 0x00, /* mov eax, 15 */
+    0x0f, 0x05 /* syscall */
+  };
+  const char* entries = table->entries.ptr;
+  const int entries_n = table->entries.size / (2 * sizeof (int));
+  const int prefix_size = strlen(error_prefix) + strlen(src->path) + 1;
+  int lines_rel_offset = 0;
+  int prefix_rel_offset = 0;
+  int suffix_rel_offset = 0;
+  int position = 0;
+  int line = 0;
+  int shift = 0;
   int i = 0;
+  int j = 0;
 
-  assert(!op->code.ptr); /* op->code must be NULL_IO_BUF */
+  patch_le_in_buf(buf, handler_rel_offset, buf->size - (handler_rel_offset + 4), 4);
+  write_to_buf(buf, rip_template, sizeof (rip_template));
+  write_le_to_buf(buf, -(buf->size + 4), 4);
+  write_to_buf(buf, lines_template, sizeof (lines_template));
+  lines_rel_offset = buf->size;
+  write_le_to_buf(buf, 0, 4);
+  write_to_buf(buf, find_template, sizeof (find_template));
+  write_le_to_buf(buf, entries_n, 4);
+  write_to_buf(buf, find_loop_template, sizeof (find_loop_template));
+  prefix_rel_offset = buf->size;
+  write_le_to_buf(buf, 0, 4);
 
-  create_io_buf(&op->code);
+  /* mov edx, imm32 */
+  write_byte_to_buf(buf, 0xba);
+  write_le_to_buf(buf, prefix_size, 4);
+  write_to_buf(buf, write_template, sizeof (write_template));
+  write_to_buf(buf, line_template, sizeof (line_template));
+  write_to_buf(buf, write_template, sizeof (write_template));
+  write_to_buf(buf, suffix_template, sizeof (suffix_template));
+  suffix_rel_offset = buf->size;
+  write_le_to_buf(buf, 0, 4);
+  write_byte_to_buf(buf, 0xba);
+  write_le_to_buf(buf, strlen(error_suffix), 4);
+  write_to_buf(buf, write_template, sizeof (write_template));
+  write_exit_fail_syscall(buf);
 
-  switch (op->type) {
-  case OP_MOVE:
-    /* -op->n because the stack goes up */
-    write_add_imm32_to_rsp(&op->code, -op->n);
-    break;
-  
-  case OP_MUTATE:
-    write_add_imm8_at_rsp(&op->code, op->n);
-    break;
+  patch_le_in_buf(buf, restorer_rel_offset, buf->size - (restorer_rel_offset + 4), 4);
+  write_to_buf(buf, restorer_template, sizeof (restorer_template));
 
-  /* TODO: OP_PRINT/INPUT don't support n>1 */
-  case OP_PRINT:
-    for (i = 0; i < op->n; ++i) {
-      write_write_syscall(&op->code);
+  /* Both the entries and the jumps are in the order of the code */
+  patch_le_in_buf(buf, lines_rel_offset, buf->size - (lines_rel_offset + 4), 4);
+  for (i = 0; i < entries_n; ++i) {
+    memcpy(&position, entries + 2 * i * sizeof (int), sizeof (int));
+    memcpy(&line, entries + (2 * i + 1) * sizeof (int), sizeof (int));
+    for (; j < jumps_n && jumps[j].position < position; ++j) {
+      if (jumps[j].is_near) {
+        shift += IF_JUMP_SIZE_NEAR - IF_JUMP_SIZE_SHORT;
+      }
     }
-    break;
+    write_le_to_buf(buf, position + shift, 4);
+    write_le_to_buf(buf, line, 4);
+  }
 
-  case OP_INPUT:
-    for (i = 0; i < op->n; ++i) {
-      write_read_syscall(&op->code);
+  patch_le_in_buf(buf, prefix_rel_offset, buf->size - (prefix_rel_offset + 4), 4);
+  write_to_buf(buf, error_prefix, strlen(error_prefix));
+  write_to_buf(buf, src->path, strlen(src->path));
+  write_byte_to_buf(buf, ':');
+  patch_le_in_buf(buf, suffix_rel_offset, buf->size - (suffix_rel_offset + 4), 4);
+  write_to_buf(buf, error_suffix, strlen(error_suffix));
+}
+
+/*
+ * Returns how many cells of `evaluation->tape` the program has to start
+ * with, the ones up to the last non-zero one.
+ */
+static int get_used_tape_size(const Evaluation* evaluation) {
+  int used_tape_size = 0;
+
+  for (used_tape_size = G_PARAMETERS.tape_size; used_tape_size > 0; --used_tape_size) {
+    if (evaluation->tape[used_tape_size - 1]) {
+      break;
     }
-    break;
+  }
 
-  case OP_IF_NOT_0:
-  case OP_IF_0:
-  default:
-    assert(0); /* Not made for this */
-    break;
+  return used_tape_size;
+}
+
+/*
+ * Returns how many cells the tape needs if the optimizer proved the pointer
+ * never leaves them, so it can live in the data segment without any guard
+ * areas, or `0` if it has to be mapped by `write_tape_setup()`.
+ */
+static int get_static_tape_size(const OptimizationInfo* info) {
+  if (
+    !info->tape_extent_known || info->min_offset < 0
+    || info->max_offset >= G_PARAMETERS.max_tape_size
+  ) {
+    return 0;
+  }
+
+  return info->max_offset + 1;
+}
+
+/*
+ * Where the parts of the data segment after the profile block are, see the
+ * layout above `CodeState`.
+ */
+typedef struct {
+  /* Cells of the evaluated tape the program starts with */
+  int image_size;
+  /* Cells of the tape in the data segment, 0 if it's mapped instead */
+  int static_tape_size;
+  /* Bytes between the evaluated output and the output buffer */
+  int tape_data_size;
+  /* Bytes before the output buffer, the profile block included */
+  int output_offset;
+} DataLayout;
+
+/*
+ * Lays out the data segment after the `profile_size` bytes of the profile
+ * block, and sets `result->data_size` to how big it is.
+ */
+static void plan_data_layout(
+  const Assembler* self, int profile_size, DataLayout* layout, AssemblerResult* result
+) {
+  layout->image_size = 0;
+  layout->output_offset = profile_size;
+  if (self->evaluation) {
+    layout->image_size = get_used_tape_size(self->evaluation);
+    layout->output_offset += self->evaluation->output.size;
+  }
+  layout->static_tape_size = get_static_tape_size(&self->optimization_info);
+  assert(!layout->static_tape_size || layout->image_size <= layout->static_tape_size);
+  /* Padded like the mapped tape, vector writes near its end read past it */
+  layout->tape_data_size = layout->static_tape_size
+    ? layout->static_tape_size + TAPE_PADDING
+    : layout->image_size;
+  layout->output_offset += layout->tape_data_size;
+
+  result->data_size = layout->output_offset
+    + G_PARAMETERS.output_buffer_size + G_PARAMETERS.input_buffer_size;
+  if (self->callable && !layout->static_tape_size) {
+    result->data_size += SLOTS_SIZE;
   }
 }
 
 /*
- * Asserts that between `if_0_op` and `if_not_0_op` all op's
- * `code` fields have a defined size.
+ * Points `rbx` at the first cell of the tape, which is right in the data
+ * segment if it's static, otherwise it's mapped by `write_tape_setup()`,
+ * which sets `*handler_rel_offset` and `*restorer_rel_offset`.
  *
- * Note: This assert means that any inner ifs must have already
- * been written. You can achieve this with recursion.
+ * Asserts `rbx` is at the data segment, and `r12` and `r13` are set.
+ */
+static void write_tape_start(
+  IoBuf* buf, const DataLayout* layout, int callable,
+  int* handler_rel_offset, int* restorer_rel_offset
+) {
+  if (layout->static_tape_size) {
+    write_add_imm32_to_rbx(buf, layout->output_offset - layout->tape_data_size);
+  } else {
+    write_tape_setup(buf, layout->image_size, callable, handler_rel_offset, restorer_rel_offset);
+  }
+}
+
+/*
+ * Appends to `result->initial_data` what was printed at compile-time and
+ * the first `image_size` cells of the tape it left, and writes what it takes
+ * to print the former.
  *
- * Sets up the `code` fields for both ops.
+ * Asserts `r12` is at the output buffer, `tape_data_size` bytes after the
+ * evaluated output.
  */
-static void write_ifs_op_codes(Op* if_0_op, Op* if_not_0_op) {
-  Op* op = NULL;
-  /* The distance between the two in instruction bytes */
-  int sizes_sum = 0;
+static void write_evaluated_output(
+  const Evaluation* evaluation, int image_size, int tape_data_size, AssemblerResult* result
+) {
+  const unsigned char template[] = { 0x49, 0x8d, 0xb4, 0x24 }; /* lea rsi, [r12+imm32] */
 
-  assert(if_0_op);
-  assert(if_not_0_op);
+  write_to_buf(&result->initial_data, evaluation->output.ptr, evaluation->output.size);
+  write_to_buf(&result->initial_data, evaluation->tape, image_size);
 
-  assert(if_0_op->type == OP_IF_0);
-  assert(if_not_0_op->type == OP_IF_NOT_0);
-  assert(if_0_op->next); /* The if_0_op must have a next. */
+  if (evaluation->output.size) {
+    write_to_buf(&result->code, template, sizeof (template));
+    write_le_to_buf(&result->code, -(evaluation->output.size + tape_data_size), 4);
+    /* mov edx, imm32 */
+    write_byte_to_buf(&result->code, 0xba);
+    write_le_to_buf(&result->code, evaluation->output.size, 4);
+    write_write_all(&result->code);
+  }
+}
 
-  /* Set up sizes_sum */
-  for (op = if_0_op->next; op != if_not_0_op; op = op->next) {
-    assert(op); /* op must lead to if_not_0_op at some point. */
-    assert(op->code.ptr && op->code.raw_size); /* All ops in-between must be initialized. */
+/*
+ * Stores `rodata` after the code, with the print string routine before it
+ * if any of `references` calls it, and sets `*rodata_position` and
+ * `*routine_position` to where they are in `buf`.
+ *
+ * Returns `0` if out of memory.
+ */
+static int place_rodata(
+  IoBuf* buf, const IoBuf* rodata, const IoBuf* references, int* rodata_position, int* routine_position
+) {
+  const CodeReference* refs = (const CodeReference*)references->ptr;
+  const int refs_n = references->size / sizeof (CodeReference);
+  int i = 0;
 
-    sizes_sum += op->code.size;
+  *routine_position = 0;
+  for (i = 0; i < refs_n; ++i) {
+    if (-1 == refs[i].target) {
+      *routine_position = buf->size;
+      write_print_string_routine(buf);
+      break;
+    }
   }
 
-  assert(!if_0_op->code.ptr); /* code must be NULL_IO_BUF */
-  create_io_buf(&if_0_op->code);
-  write_test_at_sp(&if_0_op->code);
-  
-  assert(!if_not_0_op->code.ptr); /* code must be NULL_IO_BUF */
-  create_io_buf(&if_not_0_op->code);
-  write_test_at_sp(&if_not_0_op->code);
+  *rodata_position = buf->size;
+  return !rodata->size || write_to_buf(buf, rodata->ptr, rodata->size);
+}
 
-  /*
-   * We add IF_OP_CODE_SIZE_SHORT because it is also included as part of the short jump.
-   * HISTORY: Not including it caused such a horrible edge case that took so much time to debug.
-   */
-  if (sizes_sum + IF_OP_CODE_SIZE_SHORT < 128) {
-    /* We can fit the jump in a short jump */
-    sizes_sum += IF_OP_CODE_SIZE_SHORT;
-    write_jz_short_imm8(&if_0_op->code, sizes_sum);
-    write_jnz_short_imm8(&if_not_0_op->code, -sizes_sum);
-  } else {
-    /* Gotta use the 32 bit near jump */
-    sizes_sum += IF_OP_CODE_SIZE_NEAR;
-    write_jz_near_imm32(&if_0_op->code, sizes_sum);
-    write_jnz_near_imm32(&if_not_0_op->code, -sizes_sum);
+/*
+ * Points the rel32 of each of `references` at its target, which
+ * `place_rodata()` placed, now that the code stopped moving with `jumps`.
+ */
+static void patch_rip_references(
+  IoBuf* buf, const IoBuf* references, const BracketJump* jumps, int jumps_n,
+  int rodata_position, int routine_position
+) {
+  const CodeReference* refs = (const CodeReference*)references->ptr;
+  const int refs_n = references->size / sizeof (CodeReference);
+  int position = 0;
+  int target = 0;
+  int i = 0;
+
+  for (i = 0; i < refs_n; ++i) {
+    /* rel32 is relative to the end of the instruction, which it always ends */
+    position = relaxed_position(jumps, jumps_n, refs[i].rel_offset);
+    target = -1 == refs[i].target ? routine_position : rodata_position + refs[i].target;
+    patch_le_in_buf(buf, position, target - (position + 4), 4);
   }
 }
 
 /*
- * All it needs is that you give it the first instance
- * the `OP_IF_0`, then it recursively writes the `code`
- * fields for it and its inner ops in inner-to-outer order.
- * 
- * Asserts that return value will not be NULL.
- *
- * Returns the value of the matching `OP_IF_NOT_0` of
- * this `if_0_op`.
+ * Returns the first op that can still be executed after starting from
+ * `resume_op`, that is the outermost loop around it or itself.
  */
-static Op* recursive_write_if_op_codes(Op* if_0_op) {
-  Op* op = NULL;
-  Op* if_not_0_op = NULL;
-  
-  assert(if_0_op);
+static int find_first_reachable_op(const Ops* ops, int resume_op) {
+  int outermost_loop_op = -1;
+  int depth = 0;
+  int op = 0;
 
-  assert(if_0_op->type == OP_IF_0);
-  assert(if_0_op->next); /* The if_0_op must have a next. */
-  
-  for (op = if_0_op->next; op; op = op->next) {
-    if (op->type == OP_IF_0) {
-      /* We found an inner if_0_op */
-      
-      op = recursive_write_if_op_codes(op);
-      
-      continue; /* op->next will be after the OP_IF_NOT_0 */
-    } else if (op->type == OP_IF_NOT_0) {
-      /* We found the matching if */
-      
-      write_ifs_op_codes(if_0_op, op);
-      if_not_0_op = op;
+  assert(resume_op >= 0 && resume_op < ops->len);
 
-      break;
+  for (op = 0; op < resume_op; ++op) {
+    if (OP_IF_0 == ops->types[op]) {
+      if (!depth) {
+        outermost_loop_op = op;
+      }
+      ++depth;
+    } else if (OP_IF_NOT_0 == ops->types[op]) {
+      --depth;
     }
   }
 
-  assert(if_not_0_op); /* Above code must set this to a valid value */
-  return if_not_0_op;
+  return depth ? outermost_loop_op : resume_op;
 }
 
-void assemble_x86_64(Assembler* self, AssemblerResult* result) {
-  Op* op = NULL;
+int assemble_x86_64(Assembler* self, AssemblerResult* result) {
+  const Evaluation* evaluation = self->evaluation;
+  /* Of BracketJump, in the order they are in the code */
+  IoBuf jumps_buf = NULL_IO_BUF;
+  /* Indices of the [ whose ] is still to come */
+  IoBuf open_jumps = NULL_IO_BUF;
+  BracketJump* jumps = NULL;
+  int jumps_n = 0;
+  const Ops* ops = self->ops;
+  int op = 0;
+  int match = 0;
+  int first_op = 0;
+  /* The ] of the loop whose body is being written twice, if any */
+  int unrolled_end = -1;
+  int unrolled_copy = 0;
+  /* Index of the next loop, which its counts are in the profile block at */
+  int loop = 0;
+  int profile_size = 0;
+  int resume_op = -1;
+  int flush_rel_offset = 0;
+  int refill_rel_offset = 0;
+  int resume_rel_offset = 0;
+  int resume_move_offset = 0;
+  int resume_position = 0;
+  DataLayout layout;
+  int handler_rel_offset = 0;
+  int restorer_rel_offset = 0;
+  LineTable lines = { NULL_IO_BUF, 0, 1, 0 };
+  CodeState state = {0};
+  /* Of CodeReference, in the order they are in the code */
+  IoBuf references = NULL_IO_BUF;
+  /* What they point at, stored after the code */
+  IoBuf rodata = NULL_IO_BUF;
+  /* The run of prints the current op is in, if it's printed as a string */
+  int string_start = -1;
+  int string_end = -1;
+  int string_size = 0;
+  /* The block of straight-line ops the current op is in */
+  VectorBlock block;
+  int rodata_position = 0;
+  int routine_position = 0;
+  int resume_offset = 0;
+  int success = 1;
 
   assert(self);
   assert(result);
+  assert(self->src);
+
+  block.start = -1;
+  block.end = -1;
+
+  result->initial_data = NULL_IO_BUF;
+  if (
+    !create_io_buf(&result->code)
+    || !create_io_buf(&jumps_buf)
+    || !create_io_buf(&open_jumps)
+    || !create_io_buf(&lines.entries)
+    || !create_io_buf(&references)
+    || !create_io_buf(&rodata)
+    || ((evaluation || self->profile_path) && !create_io_buf(&result->initial_data))
+  ) {
+    goto failure_;
+  }
+
+  if (self->profile_path) {
+    profile_size = write_profile_block(ops, self->profile_path, &result->initial_data);
+    if (!profile_size) {
+      goto failure_;
+    }
+  }
+  plan_data_layout(self, profile_size, &layout, result);
+
+  if (self->callable) {
+    write_push_callee_saved(&result->code);
+  }
+  result->data_address_offset = write_mov_data_address_to_rbx(&result->code);
+  write_prologue(&result->code, layout.output_offset, &flush_rel_offset);
+  write_tape_start(
+    &result->code, &layout, self->callable, &handler_rel_offset, &restorer_rel_offset
+  );
+  refill_rel_offset = write_lea_refill_to_r10(&result->code);
+
+  if (self->profile_path) {
+    write_lea_profile_to_r9(&result->code, layout.output_offset);
+  }
+
+  if (evaluation) {
+    write_evaluated_output(evaluation, layout.image_size, layout.tape_data_size, result);
+
+    resume_op = evaluation->op;
+    first_op = -1 != resume_op ? find_first_reachable_op(ops, resume_op) : ops->len;
+  }
+
+  if (evaluation) {
+    /* Patched once the pending move at resume_op is known */
+    write_add_imm32_to_rbx(&result->code, 0);
+    resume_move_offset = result->code.size - 4;
+  }
+  if (-1 != resume_op && first_op != resume_op) {
+    resume_rel_offset = write_jmp_near_imm32(&result->code);
+  }
+
+  loop = count_loops(ops, first_op);
+
+  /* Nothing before first_op is written, so nothing is known about it */
+  for (op = first_op; op < ops->len; ++op) {
+    if (op == resume_op && !unrolled_copy) {
+      /* Jumped to straight from the prologue */
+      resume_offset = state.offset;
+      resume_position = result->code.size;
+      state.al_valid = 0;
+      state.zf_valid = 0;
+    }
+
+    if (!layout.static_tape_size && !add_line_entry(&lines, self->src, ops, op, result->code.size)) {
+      goto failure_;
+    }
+
+    if (OP_PRINT_CONST == ops->types[op] && (op < string_start || op > string_end)) {
+      string_start = op;
+      string_end = find_printed_string(ops, op, resume_op, layout.static_tape_size, &string_size);
+    }
+    if (OP_PRINT_CONST == ops->types[op] && op >= string_start && op <= string_end) {
+      if (op == string_end) {
+        if (!write_printed_string(
+          ops, string_start, string_end, string_size, &result->code, &rodata, &references
+        )) {
+          goto failure_;
+        }
+        state.zf_valid = 0;
+      }
+      continue;
+    }
+
+    if (plan_vector_block(ops, op, resume_op, self->heats, &block)) {
+      if (!write_block(&result->code, &block, state.offset, &rodata, &references)) {
+        goto failure_;
+      }
+      state.offset += block.moved;
+      state.al_valid = 0;
+      state.zf_valid = 0;
+      op = block.end - 1;
+      continue;
+    }
+
+    if (ops->types[op] != OP_IF_0 && ops->types[op] != OP_IF_NOT_0) {
+      write_op_code(
+        ops, op, self->heats ? self->heats[op] : PROFILE_HEAT_WARM,
+        &result->code, &state
+      );
+      continue;
+    }
+
+    if (op == unrolled_end && !unrolled_copy) {
+      /* Leaves from in between the copies, to right after the ] */
+      write_bracket_test(&result->code, &state);
+      if (!write_bracket_jump_placeholder(&result->code, &jumps_buf, OP_IF_0, jumps_n + 1)) {
+        goto failure_;
+      }
+      ++jumps_n;
+
+      unrolled_copy = 1;
+      block.start = -1;
+      block.end = -1;
+      op = ops->matches[op];
+      continue;
+    }
+
+    if (
+      OP_IF_0 == ops->types[op] && OP_DIVMOD == ops->types[op + 1]
+      && (!self->heats || PROFILE_HEAT_COLD != self->heats[op])
+    ) {
+      write_divmod(&result->code, state.offset, ops->ns[op + 1], ops->offsets[op + 1]);
+      state.al_valid = 0;
+      state.zf_valid = 0;
+    }
+
+    if (self->profile_path && OP_IF_0 == ops->types[op]) {
+      write_inc_profile_count(&result->code, loop, PROFILE_ENTRIES_OFFSET);
+      state.zf_valid = 0;
+    }
+
+    write_bracket_test(&result->code, &state);
 
-  for (op = self->ops; op; op = op->next) {
-    if (op->type == OP_IF_0 || op->type == OP_IF_NOT_0) {
-      /* Reserved for another pass where we know how much to jump */
+    match = -1;
+    if (OP_IF_NOT_0 == ops->types[op]) {
+      /* Pop the matching [ */
+      assert(open_jumps.size);
+      open_jumps.size -= sizeof (int);
+      memcpy(&match, open_jumps.ptr + open_jumps.size, sizeof (int));
+      ((BracketJump*)jumps_buf.ptr)[match].match = jumps_n;
+    } else if (!write_to_buf(&open_jumps, &jumps_n, sizeof (int))) {
+      goto failure_;
+    }
+
+    if (!write_bracket_jump_placeholder(&result->code, &jumps_buf, ops->types[op], match)) {
+      goto failure_;
+    }
+    ++jumps_n;
+
+    if (OP_IF_NOT_0 == ops->types[op]) {
+      if (op == unrolled_end) {
+        unrolled_end = -1;
+        unrolled_copy = 0;
+      }
       continue;
     }
 
-    write_op_code(op);
+    /* Where the ] jumps back to, so it counts every iteration */
+    if (self->profile_path) {
+      write_inc_profile_count(&result->code, loop, PROFILE_ITERATIONS_OFFSET);
+      state.zf_valid = 0;
+    } else if (self->heats && should_unroll(ops, self->heats, op)) {
+      unrolled_end = ops->matches[op];
+    }
+    ++loop;
+  }
+  assert(!open_jumps.size); /* Everything from first_op on is balanced */
+
+  jumps = (BracketJump*)jumps_buf.ptr;
+  relax_bracket_jumps(&result->code, jumps, jumps_n);
+
+  if (evaluation) {
+    /* The ops from resume_op on expect the pointer at rbx+resume_offset */
+    patch_le_in_buf(&result->code, resume_move_offset, evaluation->ptr - resume_offset, 4);
+  }
+  if (resume_rel_offset) {
+    patch_le_in_buf(
+      &result->code, resume_rel_offset,
+      relaxed_position(jumps, jumps_n, resume_position) - (resume_rel_offset + 4), 4
+    );
   }
 
-  /* The aforementioned "another pass" */
-  for (op = self->ops; op; op = op->next) {
-    if (op->type == OP_IF_0) {
-      op = recursive_write_if_op_codes(op);
-      assert(op);
+  write_call_flush(&result->code);
+  if (self->profile_path) {
+    write_profile_dump(&result->code, profile_size, self->profile_path);
+  }
+  if (self->callable) {
+    if (!layout.static_tape_size) {
+      write_tape_teardown(&result->code);
     }
+    write_return_success(&result->code);
+  } else {
+    write_exit_success_syscall(&result->code);
   }
 
-  /* Finish up by copying everythin to the code buffer */
-  create_io_buf(&result->code);
+  /* rel32 is relative to the end of the lea */
+  patch_le_in_buf(
+    &result->code, flush_rel_offset,
+    result->code.size - (flush_rel_offset + 4), 4
+  );
+  write_flush_routine(&result->code);
 
-  write_add_imm32_to_rsp(&result->code, -INITIAL_STACK_FRAME);
+  patch_le_in_buf(
+    &result->code, refill_rel_offset,
+    result->code.size - (refill_rel_offset + 4), 4
+  );
+  write_refill_routine(&result->code);
 
-  for (op = self->ops; op; op = op->next) {
-    write_to_buf(&result->code, op->code.ptr, op->code.size);
+  if (!place_rodata(&result->code, &rodata, &references, &rodata_position, &routine_position)) {
+    goto failure_;
   }
-  write_exit_success_syscall(&result->code);
+  patch_rip_references(
+    &result->code, &references, jumps, jumps_n, rodata_position, routine_position
+  );
 
-  /* TODO: Delete */
-  FILE* f = fopen("bfcbin", "wb");
-  fwrite(result->code.ptr, 1, result->code.size, f);
-  fclose(f);
-}
+  if (!layout.static_tape_size) {
+    write_segv_handler(
+      &result->code, self->src, &lines, jumps, jumps_n, handler_rel_offset, restorer_rel_offset
+    );
+  }
+
+  goto done_;
 
+failure_:
+  log_error(0, "Out of memory for assembling");
+  success = 0;
+
+done_:
+  free_io_buf(&jumps_buf);
+  free_io_buf(&open_jumps);
+  free_io_buf(&lines.entries);
+  free_io_buf(&references);
+  free_io_buf(&rodata);
+  return success;
+}
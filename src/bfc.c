@@ -1,66 +1,377 @@
 /* A brainfuck compiler written in ANSI-C */
 
+/* Needed for clock_gettime() under -std=c89 */
+#define _POSIX_C_SOURCE 200112L
+
 #include "bfc.h"
 #include "assembler.h"
+#include "elf.h"
+#include "evaluator.h"
+#include "interpreter.h"
+#include "jit.h"
 #include "log.h"
 #include "op.h"
 #include "lexer.h"
 #include "optimizer.h"
+#include "parameters.h"
+#include "profile.h"
 #include "source.h"
 
+#include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define DEFAULT_OUTPUT_PATH "a.out"
+
+typedef enum {
+  /* Generate machine code, write it out or with `--run` call it. */
+  ENGINE_NATIVE,
+  /* Interpret the ops, no code is generated at all. */
+  ENGINE_INTERPRETER,
+} Engine;
+
+/*
+ * Options of `bfc` itself, rather than of the program it compiles.
+ */
+typedef struct {
+  const char* path;
+  const char* output_path;
+  /* Run the program in this process rather than writing an executable. */
+  int run;
+  Engine engine;
+  /* Report how long every stage, compiling and running took. */
+  int time;
+  /* Where the program writes how often its loops ran, if anywhere. */
+  const char* profile_path;
+  /* A profile to guide the code generation with, if any. */
+  const char* use_profile_path;
+} Options;
+
+/*
+ * If `arg` is `name=<number>`, sets `*value` to the number.
+ *
+ * Returns `1` if `arg` is the option `name`, `-1` if it is but the number is
+ * invalid or less than `min`, and `0` if it's some other argument.
+ */
+static int parse_long_option(const char* arg, const char* name, const long min, long* value) {
+  const int name_len = strlen(name);
+  char* end = NULL;
+  long n = 0;
+
+  if (strncmp(arg, name, name_len) || '=' != arg[name_len]) {
+    return 0;
+  }
+
+  n = strtol(arg + name_len + 1, &end, 10);
+  if (end == arg + name_len + 1 || *end || n < min || LONG_MAX == n) {
+    log_error(0, "Invalid value for %s: %s", name, arg + name_len + 1);
+    return -1;
+  }
+
+  *value = n;
+  return 1;
+}
+
+/*
+ * Same as `parse_long_option()` but for an `int`.
+ */
+static int parse_int_option(const char* arg, const char* name, const int min, int* value) {
+  long n = 0;
+  int matched = parse_long_option(arg, name, min, &n);
+
+  if (1 == matched) {
+    if (n > INT_MAX) {
+      log_error(0, "Invalid value for %s: %li", name, n);
+      return -1;
+    }
+    *value = n;
+  }
+
+  return matched;
+}
+
+/*
+ * Parses the command line into `*options` and `G_PARAMETERS`.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+static int parse_args(const int argc, const char** argv, Options* options) {
+  int i = 0;
+  int matched = 0;
+
+  for (i = 1; i < argc; ++i) {
+    matched = parse_int_option(argv[i], "--output-buffer-size", 1, &G_PARAMETERS.output_buffer_size);
+    if (!matched) {
+      matched = parse_int_option(argv[i], "--input-buffer-size", 1, &G_PARAMETERS.input_buffer_size);
+    }
+    if (!matched) {
+      matched = parse_long_option(argv[i], "--eval-steps", 0, &G_PARAMETERS.max_evaluation_steps);
+    }
+    if (!matched) {
+      matched = parse_int_option(argv[i], "--max-tape-size", 1, &G_PARAMETERS.max_tape_size);
+    }
+    if (matched) {
+      if (-1 == matched) {
+        return 0;
+      }
+      continue;
+    }
+
+    if (!strcmp(argv[i], "--line-buffered")) {
+      G_PARAMETERS.line_buffered = 1;
+    } else if (!strcmp(argv[i], "--prefault-tape")) {
+      G_PARAMETERS.prefault_tape = 1;
+    } else if (!strcmp(argv[i], "--unbuffered-input")) {
+      /* Never read past what the program consumes, for sharing stdin with others */
+      G_PARAMETERS.input_buffer_size = 1;
+    } else if (!strcmp(argv[i], "--eof=unchanged")) {
+      G_PARAMETERS.eof_behavior = EOF_BEHAVIOR_UNCHANGED;
+    } else if (!strcmp(argv[i], "--eof=0")) {
+      G_PARAMETERS.eof_behavior = EOF_BEHAVIOR_ZERO;
+    } else if (!strcmp(argv[i], "--eof=-1")) {
+      G_PARAMETERS.eof_behavior = EOF_BEHAVIOR_MINUS_ONE;
+    } else if (!strcmp(argv[i], "--simd=none")) {
+      G_PARAMETERS.simd_extension = SIMD_EXTENSION_NONE;
+    } else if (!strcmp(argv[i], "--simd=sse2")) {
+      G_PARAMETERS.simd_extension = SIMD_EXTENSION_SSE2;
+    } else if (!strcmp(argv[i], "--simd=avx2")) {
+      G_PARAMETERS.simd_extension = SIMD_EXTENSION_AVX2;
+    } else if (!strcmp(argv[i], "--run")) {
+      options->run = 1;
+    } else if (!strcmp(argv[i], "--engine=native")) {
+      options->engine = ENGINE_NATIVE;
+    } else if (!strcmp(argv[i], "--engine=interpreter")) {
+      options->engine = ENGINE_INTERPRETER;
+    } else if (!strcmp(argv[i], "--time")) {
+      options->time = 1;
+    } else if (!strncmp(argv[i], "--profile=", strlen("--profile="))) {
+      options->profile_path = argv[i] + strlen("--profile=");
+    } else if (!strncmp(argv[i], "--use-profile=", strlen("--use-profile="))) {
+      options->use_profile_path = argv[i] + strlen("--use-profile=");
+    } else if (!strcmp(argv[i], "-o")) {
+      if (i + 1 >= argc) {
+        log_error(0, "Missing path after -o!");
+        return 0;
+      }
+      options->output_path = argv[++i];
+    } else if ('-' == argv[i][0] && argv[i][1]) {
+      log_error(0, "Unknown option: %s", argv[i]);
+      return 0;
+    } else if (options->path) {
+      log_error(0, "Only one file can be compiled at a time!");
+      return 0;
+    } else {
+      options->path = argv[i];
+    }
+  }
+
+  if (!options->path) {
+    log_error(0, "Missing file!");
+    return 0;
+  }
+  if (G_PARAMETERS.tape_size > G_PARAMETERS.max_tape_size) {
+    /* Nothing may start with more of the tape than it can ever have */
+    G_PARAMETERS.tape_size = G_PARAMETERS.max_tape_size;
+  }
+  if ((options->profile_path || options->use_profile_path) && ENGINE_NATIVE != options->engine) {
+    log_error(0, "Profiles only work with the native engine!");
+    return 0;
+  }
+  if (options->profile_path && options->use_profile_path) {
+    /* The unrolled loops would only count half their iterations */
+    log_error(0, "A profiled program can't be built from a profile!");
+    return 0;
+  }
+  if (
+    (options->profile_path && !*options->profile_path)
+    || (options->use_profile_path && !*options->use_profile_path)
+  ) {
+    log_error(0, "Missing path for the profile!");
+    return 0;
+  }
+
+  return 1;
+}
+
+/*
+ * Returns seconds since some fixed point in the past, for timing stages.
+ */
+static double get_seconds(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+ * With `--time`, reports how long `stage` took since `*stage_start`, and the
+ * peak RSS so far, then starts the next stage.
+ */
+static void end_stage(const Options* options, const char* stage, double* stage_start) {
+  struct rusage usage;
+  double now = 0;
+
+  if (!options->time) {
+    return;
+  }
 
-/* TODO: Hardcoded */
-void assemble_x86_64(Assembler* self, AssemblerResult* result);
+  now = get_seconds();
+  getrusage(RUSAGE_SELF, &usage);
+  log_info(
+    0, "Stage %s took %.3f ms, peak RSS %li KiB.",
+    stage, (now - *stage_start) * 1000, usage.ru_maxrss
+  );
+  *stage_start = get_seconds();
+}
 
-/* TODO: In x86 ADD sets ZF=1 if src+dst=0, so if the last operation is guaranteed to be ADD for
- * the bytes(and not ADD for the stack pointer) we can skip CMP and do only JZ/JNZ for [/].
+/*
+ * Generates machine code for `ops`, and either writes it out as an
+ * executable or runs it, depending on `options`. `heats` are from
+ * `apply_profile()`, if there is a profile.
+ *
+ * Sets `*compiled` to when the code was ready, `*stage_start` is as for
+ * `end_stage()`.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
  */
-/* TODO: OP_MUTATE and OP_MOVE with n=1 should be INC, and n=-1 DEC */
+static int compile_native(
+  Source* src, const Ops* ops, const OptimizationInfo* optimization_info,
+  const unsigned char* heats, const Options* options, double* compiled, double* stage_start
+) {
+  Evaluation evaluation = {0};
+  Assembler assembler = G_X86_64_ASSEMBLER_TEMPLATE;
+  AssemblerResult result = {0};
+  int success = 0;
+
+  assembler.ops = ops;
+  assembler.optimization_info = *optimization_info;
+  assembler.callable = options->run;
+  assembler.profile_path = options->profile_path;
+  assembler.heats = heats;
+  assembler.src = src;
+
+  /* Loops run at compile-time wouldn't be counted */
+  if (G_PARAMETERS.max_evaluation_steps && !options->profile_path) {
+    success = evaluate_ops(src, ops, G_PARAMETERS.max_evaluation_steps, &evaluation);
+    if (!success) {
+      goto done_;
+    }
+    assembler.evaluation = &evaluation;
+    end_stage(options, "evaluate", stage_start);
+  }
+
+  success = assembler.assemble(&assembler, &result);
+  if (!success) {
+    goto done_;
+  }
+  end_stage(options, "assemble", stage_start);
+
+  *compiled = get_seconds();
+  if (options->run) {
+    success = run_jit_x86_64(&result);
+    end_stage(options, "run", stage_start);
+  } else {
+    success = write_elf_x86_64(options->output_path, &result);
+    end_stage(options, "write", stage_start);
+  }
+
+done_:
+  free_assembler_result(&result);
+  free_evaluation(&evaluation);
+  return success;
+}
 
 int main(const int argc, const char** argv) {
-  /* TODO: Everything up until the first input instruction can be cached. */
-  Op* ops;
-  const char* path = "stdin";
+  Arena arena;
+  Ops ops;
+  Options options = {0};
   char* text = NULL;
-  int success = 1;
+  int success = 0;
   Source src;
   OptimizationInfo optimization_info;
-  Assembler assembler = {0};
+  Profile profile;
+  unsigned char* heats = NULL;
+  double started = 0;
+  double compiled = 0;
+  double finished = 0;
+  double stage_start = 0;
 
-  if (argc < 2) {
-    log_error(0, "Missing file!");
+  /* Everything the compilation allocates per op lives here */
+  create_arena(&arena);
+
+  options.output_path = DEFAULT_OUTPUT_PATH;
+  options.engine = ENGINE_NATIVE;
+  if (!parse_args(argc, argv, &options)) {
     goto done_;
-  } else {
-    path = argv[1];
-    text = read_from_path(path);
-    if (!text) {
-      success = 0;
-      goto done_;
-    }
   }
 
-  src = create_source(path, text);
-  
-  success = lex(&src, &ops);
+  started = get_seconds();
+  stage_start = started;
+
+  text = read_from_path(options.path);
+  if (!text) {
+    goto done_;
+  }
+  end_stage(&options, "read", &stage_start);
+
+  success = create_source(&src, options.path, text, &arena);
+  if (!success) {
+    goto done_;
+  }
+
+  success = lex(&src, &arena, &ops);
   if (!success) {
     goto done_;
   }
+  end_stage(&options, "lex", &stage_start);
 
   optimization_info = optimize_ops(&src, &ops);
+  end_stage(&options, "optimize", &stage_start);
 
-  /* TODO: Hardcoded */
-  assembler.ops = ops;
-  assemble_x86_64(&assembler, NULL);
+  if (options.use_profile_path) {
+    success = read_profile(options.use_profile_path, &arena, &profile)
+      && apply_profile(&src, &ops, &profile, &arena, &heats);
+    if (!success) {
+      goto done_;
+    }
+    end_stage(&options, "profile", &stage_start);
+  }
 
-done_:
-  if (ops) {
-    free_ops(ops);
+  if (ENGINE_INTERPRETER == options.engine) {
+    compiled = get_seconds();
+    success = interpret_ops(&src, &ops);
+    end_stage(&options, "run", &stage_start);
+  } else {
+    success = compile_native(&src, &ops, &optimization_info, heats, &options, &compiled, &stage_start);
+  }
+  if (!success) {
+    goto done_;
   }
+
+  finished = get_seconds();
+  if (options.time) {
+    if (ENGINE_INTERPRETER == options.engine || options.run) {
+      log_info(
+        0, "Compiled in %.3f ms, ran in %.3f ms with the %s engine.",
+        (compiled - started) * 1000, (finished - compiled) * 1000,
+        ENGINE_INTERPRETER == options.engine ? "interpreter" : "native"
+      );
+    } else {
+      log_info(0, "Compiled in %.3f ms.", (finished - started) * 1000);
+    }
+  }
+
+done_:
+  free_arena(&arena);
   if (text) {
     free(text);
   }
 
   return !success;
 }
-
@@ -0,0 +1,134 @@
+/* Needed for chmod() under -std=c89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include "elf.h"
+#include "io_buf.h"
+#include "log.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+/* Where the file gets mapped, the classic non-PIE base. */
+#define ELF_BASE_VADDR (0x400000UL)
+#define ELF_PAGE_SIZE (0x1000UL)
+
+#define ELF_HEADER_SIZE (64)
+#define ELF_PROGRAM_HEADER_SIZE (56)
+#define ELF_PROGRAM_HEADERS_N (2)
+#define ELF_HEADERS_SIZE (ELF_HEADER_SIZE + ELF_PROGRAM_HEADERS_N * ELF_PROGRAM_HEADER_SIZE)
+
+#define ELF_PT_LOAD (1)
+#define ELF_PF_X (1)
+#define ELF_PF_W (2)
+#define ELF_PF_R (4)
+
+static void write_elf_header(IoBuf* buf, unsigned long entry) {
+  const char ident[] = {
+    0x7f, 'E', 'L', 'F',
+    2, /* ELFCLASS64 */
+    1, /* ELFDATA2LSB */
+    1, /* EV_CURRENT */
+    0, /* ELFOSABI_SYSV */
+    0, 0, 0, 0, 0, 0, 0, 0 /* Padding */
+  };
+
+  write_to_buf(buf, ident, sizeof (ident));
+  write_le_to_buf(buf, 2, 2); /* e_type = ET_EXEC */
+  write_le_to_buf(buf, 62, 2); /* e_machine = EM_X86_64 */
+  write_le_to_buf(buf, 1, 4); /* e_version */
+  write_le_to_buf(buf, entry, 8); /* e_entry */
+  write_le_to_buf(buf, ELF_HEADER_SIZE, 8); /* e_phoff */
+  write_le_to_buf(buf, 0, 8); /* e_shoff */
+  write_le_to_buf(buf, 0, 4); /* e_flags */
+  write_le_to_buf(buf, ELF_HEADER_SIZE, 2); /* e_ehsize */
+  write_le_to_buf(buf, ELF_PROGRAM_HEADER_SIZE, 2); /* e_phentsize */
+  write_le_to_buf(buf, ELF_PROGRAM_HEADERS_N, 2); /* e_phnum */
+  write_le_to_buf(buf, 0, 2); /* e_shentsize */
+  write_le_to_buf(buf, 0, 2); /* e_shnum */
+  write_le_to_buf(buf, 0, 2); /* e_shstrndx */
+}
+
+static void write_elf_load_program_header(
+  IoBuf* buf, int flags, unsigned long offset, unsigned long vaddr,
+  unsigned long file_size, unsigned long mem_size
+) {
+  write_le_to_buf(buf, ELF_PT_LOAD, 4); /* p_type */
+  write_le_to_buf(buf, flags, 4); /* p_flags */
+  write_le_to_buf(buf, offset, 8); /* p_offset */
+  write_le_to_buf(buf, vaddr, 8); /* p_vaddr */
+  write_le_to_buf(buf, vaddr, 8); /* p_paddr */
+  write_le_to_buf(buf, file_size, 8); /* p_filesz */
+  write_le_to_buf(buf, mem_size, 8); /* p_memsz */
+  write_le_to_buf(buf, ELF_PAGE_SIZE, 8); /* p_align */
+}
+
+int write_elf_x86_64(const char* path, AssemblerResult* result) {
+  IoBuf headers = NULL_IO_BUF;
+  FILE* f = NULL;
+  unsigned long code_file_size = 0;
+  unsigned long data_vaddr = 0;
+  int success = 0;
+
+  assert(path);
+  assert(result && result->code.ptr);
+
+  code_file_size = ELF_HEADERS_SIZE + result->code.size;
+
+  /*
+   * The data segment starts on the page after the code, but its address must
+   * be congruent to its file offset modulo the page size.
+   */
+  data_vaddr = (ELF_BASE_VADDR + code_file_size + ELF_PAGE_SIZE - 1) & ~(ELF_PAGE_SIZE - 1);
+  data_vaddr += code_file_size % ELF_PAGE_SIZE;
+
+  patch_data_address(result, data_vaddr);
+
+  if (!create_io_buf(&headers)) {
+    log_error(0, "Could not allocate ELF headers!");
+    goto done_;
+  }
+
+  write_elf_header(&headers, ELF_BASE_VADDR + ELF_HEADERS_SIZE);
+  write_elf_load_program_header(
+    &headers, ELF_PF_R | ELF_PF_X, 0, ELF_BASE_VADDR, code_file_size, code_file_size
+  );
+  write_elf_load_program_header(
+    &headers, ELF_PF_R | ELF_PF_W, code_file_size, data_vaddr,
+    result->initial_data.size, result->data_size
+  );
+  assert(headers.size == ELF_HEADERS_SIZE);
+
+  if (!(f = fopen(path, "wb"))) {
+    log_error(0, "File could not be opened for writing: %s", path);
+    goto done_;
+  }
+
+  if (
+    fwrite(headers.ptr, 1, headers.size, f) != headers.size
+    || fwrite(result->code.ptr, 1, result->code.size, f) != result->code.size
+    || (
+      result->initial_data.size
+      && fwrite(result->initial_data.ptr, 1, result->initial_data.size, f) != result->initial_data.size
+    )
+  ) {
+    log_error(0, "Could not write executable: %s", path);
+    goto done_;
+  }
+
+  if (chmod(path, 0755)) {
+    log_error(0, "Could not make executable: %s", path);
+    goto done_;
+  }
+
+  success = 1;
+
+done_:
+  if (f) {
+    fclose(f);
+  }
+  if (headers.ptr) {
+    free_io_buf(&headers);
+  }
+  return success;
+}
@@ -0,0 +1,19 @@
+#ifndef BFC_ELF_H
+#define BFC_ELF_H
+
+#include "assembler.h"
+
+/*
+ * Writes a minimal static ELF64 executable to `path`, made of one read+execute
+ * segment for the headers and `result->code`, and one read+write segment
+ * for the data, which the kernel zero fills for us.
+ *
+ * Patches the data address into `result->code` in the process.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+int write_elf_x86_64(const char* path, AssemblerResult* result);
+
+#endif /* ifndef BFC_ELF_H */
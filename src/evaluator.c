@@ -0,0 +1,154 @@
+#include "evaluator.h"
+#include "log.h"
+#include "parameters.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+int evaluate_ops(Source* src, const Ops* ops, const long max_steps, Evaluation* evaluation) {
+  const int* matches = ops->matches;
+  unsigned char* tape = NULL;
+  int ptr = 0;
+  int n = 0;
+  int i = 0;
+  int j = 0;
+  long steps = 0;
+
+  evaluation->tape = NULL;
+  evaluation->output = NULL_IO_BUF;
+
+  tape = calloc(G_PARAMETERS.tape_size, 1);
+  if (!tape || !create_io_buf(&evaluation->output)) {
+    log_error(0, "Could not allocate compile-time evaluation state!");
+    goto failure_;
+  }
+
+  for (i = 0; i < ops->len && steps < max_steps; ++i, ++steps) {
+    n = ops->ns[i];
+
+    switch (ops->types[i]) {
+    case OP_MUTATE:
+      tape[ptr] += n;
+      break;
+
+    case OP_MOVE:
+      if (ptr + n < 0 || ptr + n >= G_PARAMETERS.tape_size) {
+        /* Leave it for the program to trip over at runtime */
+        goto done_;
+      }
+      ptr += n;
+      break;
+
+    case OP_PRINT:
+      for (j = 0; j < n; ++j) {
+        write_byte_to_buf(&evaluation->output, tape[ptr]);
+      }
+      break;
+
+    case OP_INPUT:
+      goto done_;
+
+    case OP_CLEAR:
+      tape[ptr] = 0;
+      break;
+
+    case OP_MUL_ADD:
+      if (ptr + ops->offsets[i] < 0 || ptr + ops->offsets[i] >= G_PARAMETERS.tape_size) {
+        goto done_;
+      }
+      tape[ptr + ops->offsets[i]] += tape[ptr] * n;
+      break;
+
+    case OP_SET:
+      if (ptr + ops->offsets[i] < 0 || ptr + ops->offsets[i] >= G_PARAMETERS.tape_size) {
+        goto done_;
+      }
+      tape[ptr + ops->offsets[i]] = n;
+      break;
+
+    case OP_PRINT_CONST:
+      for (j = 0; j < n; ++j) {
+        write_byte_to_buf(&evaluation->output, ops->offsets[i]);
+      }
+      break;
+
+    case OP_CMP_ADD:
+      if (ptr + ops->offsets[i] < 0 || ptr + ops->offsets[i] >= G_PARAMETERS.tape_size) {
+        goto done_;
+      }
+      if (tape[ptr]) {
+        tape[ptr + ops->offsets[i]] += n;
+      }
+      break;
+
+    case OP_DIVMOD:
+      if (ptr + n + 4 < G_PARAMETERS.tape_size && divide_bytes(tape + ptr, n, ops->offsets[i])) {
+        i = matches[i - 1];
+      } else {
+        --tape[ptr];
+      }
+      break;
+
+    case OP_SCAN:
+      for (j = ptr; tape[j]; j += n) {
+        if (j + n < 0 || j + n >= G_PARAMETERS.tape_size) {
+          goto done_;
+        }
+      }
+      ptr = j;
+      break;
+
+    case OP_IF_0:
+      if (!tape[ptr]) {
+        i = matches[i];
+      }
+      break;
+
+    case OP_IF_NOT_0:
+      if (tape[ptr]) {
+        i = matches[i];
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+done_:
+  evaluation->tape = tape;
+  evaluation->ptr = ptr;
+  evaluation->op = i < ops->len ? i : -1;
+  evaluation->steps = steps;
+
+  if (-1 != evaluation->op) {
+    set_source_i(src, ops, evaluation->op);
+    log_debug(
+      src, "evaluator: Evaluated %li ops and %i printed bytes at compile-time, continuing from here.",
+      steps, evaluation->output.size
+    );
+  } else {
+    log_debug(
+      src, "evaluator: Evaluated the entire program, %li ops and %i printed bytes, at compile-time.",
+      steps, evaluation->output.size
+    );
+  }
+
+  return 1;
+
+failure_:
+  free(tape);
+  if (evaluation->output.ptr) {
+    free_io_buf(&evaluation->output);
+  }
+  return 0;
+}
+
+void free_evaluation(Evaluation* evaluation) {
+  free(evaluation->tape);
+  evaluation->tape = NULL;
+  if (evaluation->output.ptr) {
+    free_io_buf(&evaluation->output);
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef BFC_EVALUATOR_H
+#define BFC_EVALUATOR_H
+
+#include "io_buf.h"
+#include "op.h"
+#include "source.h"
+
+/*
+ * State of the program after running it at compile-time, up until it needed
+ * input, went out of the tape, ran out of steps or finished.
+ *
+ * Everything the program did up to that point never needs to run again,
+ * the assembler can start the program right from this state.
+ */
+typedef struct {
+  /*
+   * The tape, `G_PARAMETERS.tape_size` cells.
+   */
+  unsigned char* tape;
+
+  /*
+   * Index of the current cell within `tape`.
+   */
+  int ptr;
+
+  /*
+   * Index of the op execution continues from, `-1` if the program finished.
+   */
+  int op;
+
+  /*
+   * Everything printed before `op`.
+   */
+  IoBuf output;
+
+  /*
+   * How many ops were executed, never more than the budget.
+   */
+  long steps;
+} Evaluation;
+
+/*
+ * Runs `ops` at compile-time for at most `max_steps` ops.
+ *
+ * On success, returns `1` and fills `*evaluation`, to be freed with `free_evaluation()`.
+ *
+ * On failure, returns `0`.
+ */
+int evaluate_ops(Source* src, const Ops* ops, const long max_steps, Evaluation* evaluation);
+
+void free_evaluation(Evaluation* evaluation);
+
+#endif /* ifndef BFC_EVALUATOR_H */
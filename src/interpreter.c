@@ -0,0 +1,376 @@
+/* Needed for read() and write() under -std=c89 */
+#define _POSIX_C_SOURCE 200112L
+
+#include "interpreter.h"
+#include "log.h"
+#include "parameters.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Where GCC extensions are around, every op jumps straight to the code of
+ * the next one through a table of label addresses, rather than going back
+ * to a `switch`, so each op gets its own indirect branch to predict.
+ */
+#ifdef __GNUC__
+#  define BFC_THREADED_CODE
+#endif
+
+#ifdef BFC_THREADED_CODE
+#  define OP_CASE(TYPE) label_##TYPE:
+#  define NEXT_OP() goto *targets[++i]
+#else
+#  define OP_CASE(TYPE) case TYPE:
+#  define NEXT_OP() continue
+#endif
+
+/*
+ * The output and input buffers, which behave like the ones of the
+ * generated program.
+ */
+typedef struct {
+  unsigned char* output;
+  int output_used;
+
+  unsigned char* input;
+  int input_next;
+  int input_end;
+} InterpreterIo;
+
+/*
+ * Writes out and empties the output buffer.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+static int flush_output(InterpreterIo* io) {
+  ssize_t written = 0;
+  int i = 0;
+
+  while (i < io->output_used) {
+    written = write(1, io->output + i, io->output_used - i);
+    if (written <= 0) {
+      log_error(0, "Could not write the output!");
+      return 0;
+    }
+    i += written;
+  }
+  io->output_used = 0;
+
+  return 1;
+}
+
+/*
+ * Appends `byte` to the output buffer, writing it out once it fills up, or
+ * on newlines if `G_PARAMETERS.line_buffered`.
+ */
+static int print_byte(InterpreterIo* io, const unsigned char byte) {
+  io->output[io->output_used++] = byte;
+
+  if (
+    io->output_used == G_PARAMETERS.output_buffer_size
+    || (G_PARAMETERS.line_buffered && '\n' == byte)
+  ) {
+    return flush_output(io);
+  }
+
+  return 1;
+}
+
+/*
+ * Reads the next input byte into `*byte`, following `G_PARAMETERS.eof_behavior`
+ * once there is none, flushes the output before waiting for more.
+ *
+ * Returns `1` on success, `0` if the output could not be written.
+ */
+static int input_byte(InterpreterIo* io, unsigned char* byte) {
+  ssize_t got = 0;
+
+  if (io->input_next == io->input_end) {
+    if (!flush_output(io)) {
+      return 0;
+    }
+
+    got = read(0, io->input, G_PARAMETERS.input_buffer_size);
+    if (got <= 0) {
+      switch (G_PARAMETERS.eof_behavior) {
+      case EOF_BEHAVIOR_ZERO:
+        *byte = 0;
+        break;
+      case EOF_BEHAVIOR_MINUS_ONE:
+        *byte = 0xff;
+        break;
+      default:
+        break;
+      }
+      return 1;
+    }
+
+    io->input_next = 0;
+    io->input_end = got;
+  }
+
+  *byte = io->input[io->input_next++];
+  return 1;
+}
+
+/*
+ * Grows `*tape` of `*tape_size` cells so `ptr` is within it, at least
+ * doubling it, up to `G_PARAMETERS.max_tape_size` cells like the generated
+ * program's tape can.
+ *
+ * Returns `0` if `ptr` is past that, or there is no memory for it.
+ */
+static int grow_tape(unsigned char** tape, int* tape_size, int ptr) {
+  unsigned char* grown = NULL;
+  int size = *tape_size;
+
+  if (ptr >= G_PARAMETERS.max_tape_size) {
+    return 0;
+  }
+
+  while (size <= ptr) {
+    size = size > G_PARAMETERS.max_tape_size / 2 ? G_PARAMETERS.max_tape_size : size * 2;
+  }
+  grown = realloc(*tape, size);
+  if (!grown) {
+    log_error(0, "Could not grow the tape to %i cells!", size);
+    return 0;
+  }
+
+  memset(grown + *tape_size, 0, size - *tape_size);
+  *tape = grown;
+  *tape_size = size;
+  return 1;
+}
+
+/* Computed goto has no ISO C equivalent, which is the point */
+#ifdef BFC_THREADED_CODE
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+int interpret_ops(Source* src, const Ops* ops) {
+  int tape_size = G_PARAMETERS.tape_size;
+  const unsigned char* types = ops->types;
+  const int* ns = ops->ns;
+  const int* offsets = ops->offsets;
+  const int* matches = ops->matches;
+  InterpreterIo io = {0};
+  unsigned char* tape = NULL;
+#ifdef BFC_THREADED_CODE
+  /* Address of the code of each op, and of the end after the last one */
+  void** targets = NULL;
+#endif
+  int ptr = 0;
+  int to = 0;
+  int i = 0;
+  int j = 0;
+  int success = 1;
+
+  tape = calloc(tape_size, 1);
+  io.output = malloc(G_PARAMETERS.output_buffer_size);
+  io.input = malloc(G_PARAMETERS.input_buffer_size);
+#ifdef BFC_THREADED_CODE
+  targets = malloc((ops->len + 1) * sizeof (void*));
+  if (!targets) {
+    goto out_of_memory_;
+  }
+#endif
+  if (!tape || !io.output || !io.input) {
+    goto out_of_memory_;
+  }
+
+#ifdef BFC_THREADED_CODE
+  for (i = 0; i < ops->len; ++i) {
+    switch (types[i]) {
+    case OP_MUTATE:
+      targets[i] = &&label_OP_MUTATE;
+      break;
+    case OP_MOVE:
+      targets[i] = &&label_OP_MOVE;
+      break;
+    case OP_INPUT:
+      targets[i] = &&label_OP_INPUT;
+      break;
+    case OP_PRINT:
+      targets[i] = &&label_OP_PRINT;
+      break;
+    case OP_IF_0:
+      targets[i] = &&label_OP_IF_0;
+      break;
+    case OP_IF_NOT_0:
+      targets[i] = &&label_OP_IF_NOT_0;
+      break;
+    case OP_CLEAR:
+      targets[i] = &&label_OP_CLEAR;
+      break;
+    case OP_MUL_ADD:
+      targets[i] = &&label_OP_MUL_ADD;
+      break;
+    case OP_SCAN:
+      targets[i] = &&label_OP_SCAN;
+      break;
+    case OP_SET:
+      targets[i] = &&label_OP_SET;
+      break;
+    case OP_PRINT_CONST:
+      targets[i] = &&label_OP_PRINT_CONST;
+      break;
+    case OP_CMP_ADD:
+      targets[i] = &&label_OP_CMP_ADD;
+      break;
+    case OP_DIVMOD:
+      targets[i] = &&label_OP_DIVMOD;
+      break;
+    default:
+      targets[i] = &&label_OP_SKIP;
+      break;
+    }
+  }
+  targets[ops->len] = &&end_;
+
+  i = -1;
+  NEXT_OP();
+  {
+#else
+  for (i = 0; i < ops->len; ++i) {
+    switch (types[i]) {
+    default:
+#endif
+    OP_CASE(OP_SKIP)
+      NEXT_OP();
+
+    OP_CASE(OP_MUTATE)
+      tape[ptr] += ns[i];
+      NEXT_OP();
+
+    OP_CASE(OP_MOVE)
+      ptr += ns[i];
+      if (ptr < 0 || (ptr >= tape_size && !grow_tape(&tape, &tape_size, ptr))) {
+        goto out_of_tape_;
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_INPUT)
+      for (j = 0; j < ns[i]; ++j) {
+        if (!input_byte(&io, tape + ptr)) {
+          goto failure_;
+        }
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_PRINT)
+      for (j = 0; j < ns[i]; ++j) {
+        if (!print_byte(&io, tape[ptr])) {
+          goto failure_;
+        }
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_IF_0)
+      if (!tape[ptr]) {
+        i = matches[i];
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_IF_NOT_0)
+      if (tape[ptr]) {
+        i = matches[i];
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_CLEAR)
+      tape[ptr] = 0;
+      NEXT_OP();
+
+    OP_CASE(OP_MUL_ADD)
+      to = ptr + offsets[i];
+      if (to < 0 || (to >= tape_size && !grow_tape(&tape, &tape_size, to))) {
+        goto out_of_tape_;
+      }
+      tape[to] += tape[ptr] * ns[i];
+      NEXT_OP();
+
+    OP_CASE(OP_SET)
+      to = ptr + offsets[i];
+      if (to < 0 || (to >= tape_size && !grow_tape(&tape, &tape_size, to))) {
+        goto out_of_tape_;
+      }
+      tape[to] = ns[i];
+      NEXT_OP();
+
+    OP_CASE(OP_PRINT_CONST)
+      for (j = 0; j < ns[i]; ++j) {
+        if (!print_byte(&io, offsets[i])) {
+          goto failure_;
+        }
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_CMP_ADD)
+      to = ptr + offsets[i];
+      if (to < 0 || (to >= tape_size && !grow_tape(&tape, &tape_size, to))) {
+        goto out_of_tape_;
+      }
+      if (tape[ptr]) {
+        tape[to] += ns[i];
+      }
+      NEXT_OP();
+
+    OP_CASE(OP_DIVMOD)
+      /* The loop after it grows the tape if it has to */
+      if (ptr + ns[i] + 4 < tape_size && divide_bytes(tape + ptr, ns[i], offsets[i])) {
+        i = matches[i - 1];
+        NEXT_OP();
+      }
+      --tape[ptr];
+      NEXT_OP();
+
+    OP_CASE(OP_SCAN)
+      while (tape[ptr]) {
+        ptr += ns[i];
+        if (ptr < 0 || (ptr >= tape_size && !grow_tape(&tape, &tape_size, ptr))) {
+          goto out_of_tape_;
+        }
+      }
+      NEXT_OP();
+    }
+#ifdef BFC_THREADED_CODE
+end_:
+#else
+  }
+#endif
+
+  success = flush_output(&io);
+  goto done_;
+
+out_of_tape_:
+  flush_output(&io);
+  set_source_i(src, ops, i);
+  log_error(src, "Pointer went out of the tape!");
+  goto failure_;
+
+out_of_memory_:
+  log_error(0, "Could not allocate the interpreter state!");
+
+failure_:
+  success = 0;
+
+done_:
+#ifdef BFC_THREADED_CODE
+  free(targets);
+#endif
+  free(tape);
+  free(io.output);
+  free(io.input);
+  return success;
+}
+
+#ifdef BFC_THREADED_CODE
+#  pragma GCC diagnostic pop
+#endif
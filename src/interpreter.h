@@ -0,0 +1,21 @@
+#ifndef BFC_INTERPRETER_H
+#define BFC_INTERPRETER_H
+
+#include "op.h"
+#include "source.h"
+
+/*
+ * Runs `ops` right away, without generating any code, doing the same
+ * buffered I/O on stdin and stdout the generated program would.
+ *
+ * Unlike the generated program, it stops with an error pointing at the op
+ * when the pointer leaves the tape, which makes it the reference to check
+ * the optimizer and the assembler against.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+int interpret_ops(Source* src, const Ops* ops);
+
+#endif /* ifndef BFC_INTERPRETER_H */
@@ -49,7 +49,7 @@ int write_to_buf(IoBuf* buf, const void* data, const int size) {
   return 1;
 }
 
-int write_byte_to_buf(IoBuf* buf, const char byte) {
+int write_byte_to_buf(IoBuf* buf, const unsigned char byte) {
   assert(buf->ptr && buf->raw_size);
   
   ++buf->size;
@@ -62,3 +62,25 @@ int write_byte_to_buf(IoBuf* buf, const char byte) {
   return 1;
 }
 
+
+int write_le_to_buf(IoBuf* buf, unsigned long value, const int size) {
+  int i = 0;
+
+  for (i = 0; i < size; ++i, value >>= 8) {
+    if (!write_byte_to_buf(buf, value & 0xff)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+void patch_le_in_buf(IoBuf* buf, const int offset, unsigned long value, const int size) {
+  int i = 0;
+
+  assert(offset >= 0 && offset + size <= buf->size);
+
+  for (i = 0; i < size; ++i, value >>= 8) {
+    buf->ptr[offset + i] = value & 0xff;
+  }
+}
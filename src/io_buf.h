@@ -20,7 +20,19 @@ void free_io_buf(IoBuf* buf);
 
 int write_to_buf(IoBuf* buf, const void* data, const int size);
 
-int write_byte_to_buf(IoBuf* buf, const char byte);
+int write_byte_to_buf(IoBuf* buf, const unsigned char byte);
+
+/*
+ * Writes the lowest `size` bytes of `value` in little-endian order,
+ * regardless of the host's endianess.
+ */
+int write_le_to_buf(IoBuf* buf, unsigned long value, const int size);
+
+/*
+ * Overwrites `size` bytes at `offset` with `value` in little-endian order.
+ * Used for filling in values that are only known after they were written.
+ */
+void patch_le_in_buf(IoBuf* buf, const int offset, unsigned long value, const int size);
 
 #endif /* ifndef IO_BUF_H */
 
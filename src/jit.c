@@ -0,0 +1,57 @@
+/* Needed for mmap() and MAP_ANONYMOUS under -std=c89 */
+#define _DEFAULT_SOURCE
+
+#include "jit.h"
+#include "io_buf.h"
+#include "log.h"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/mman.h>
+
+int run_jit_x86_64(AssemblerResult* result) {
+  void* data = MAP_FAILED;
+  void* code = MAP_FAILED;
+  int (*entry)(void) = NULL;
+  int success = 0;
+
+  assert(result && result->code.ptr);
+  assert(result->data_size >= result->initial_data.size);
+
+  /* Anonymous mappings come zero filled, just like the ELF data segment */
+  data = mmap(NULL, result->data_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == data) {
+    log_error(0, "Could not map %i bytes for the data segment!", result->data_size);
+    goto done_;
+  }
+  if (result->initial_data.size) {
+    memcpy(data, result->initial_data.ptr, result->initial_data.size);
+  }
+
+  patch_data_address(result, (unsigned long)data);
+
+  /* Never writable and executable at once */
+  code = mmap(NULL, result->code.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == code) {
+    log_error(0, "Could not map %i bytes for the code!", result->code.size);
+    goto done_;
+  }
+  memcpy(code, result->code.ptr, result->code.size);
+  if (mprotect(code, result->code.size, PROT_READ | PROT_EXEC)) {
+    log_error(0, "Could not make the code executable!");
+    goto done_;
+  }
+
+  /* ISO C has no cast from an object pointer to a function pointer */
+  memcpy(&entry, &code, sizeof (code));
+  success = !entry();
+
+done_:
+  if (MAP_FAILED != code) {
+    munmap(code, result->code.size);
+  }
+  if (MAP_FAILED != data) {
+    munmap(data, result->data_size);
+  }
+  return success;
+}
@@ -0,0 +1,21 @@
+#ifndef BFC_JIT_H
+#define BFC_JIT_H
+
+#include "assembler.h"
+
+/*
+ * Runs `result` in this process: maps a zero filled data segment holding
+ * `result->initial_data`, patches its address into `result->code`, copies
+ * the code into an executable mapping and calls it.
+ *
+ * The code must have been assembled with `Assembler.callable` set. The
+ * program does its I/O on the process' stdin and stdout like the executable
+ * would, and still exits the process with failure if a `write` fails.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+int run_jit_x86_64(AssemblerResult* result);
+
+#endif /* ifndef BFC_JIT_H */
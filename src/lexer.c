@@ -3,264 +3,135 @@
 #include "op.h"
 
 #include <assert.h>
-#include <stdlib.h>
 
 /*
- * `src->text[src->i]` is asserted to point to the bracket.
- *
- * On success, returns `1`, and sets `op->n` to the distance in non `OP_SKIP`
- * characters from this bracket, if it's `]` it should be negative.
- * 
- * On failure, `0` if delimiter is not found.
- *
- * NOTE: Don't forget, the returned `n` is not normalized to `Op` units.
- * You must do so manually.
- *
- * `OP_SKIP` is ignored because we can do so in this stage and it will
- * prevent more complicated computation later due to getting rid of them.
+ * Returns how many characters in `src->text` are commands, no program can
+ * have more ops than that.
  */
-static int find_delimiter_for_if(const Source* src, Op* op) {
-  const char c = src->text[src->i];
-  const OpType type = op_type_from_c(c);
-  /* What is the delimiter we are looking for? */
-  const int delim = type == OP_IF_0 ? ']' : '[';
-  /* If it's [ we iterate forward otherwise back */
-  const int j_inc = type == OP_IF_0 ? 1 : -1;
-  int j = 0;
-  int n = 0;
-  /* If we find nested brackets we increment it to ignore them. */
-  int bracket_depth = 1;
-
-  assert('[' == c || ']' == c); /* Otherwise no point in calling this. */
-
-  for (j = src->i + j_inc; j >= 0 && j < src->len; j += j_inc) {
-    n += j_inc;
+static int count_commands(const Source* src) {
+  int count = 0;
+  int i = 0;
 
-    if (c == src->text[j]) {
-      ++bracket_depth;
-    } else if (delim == src->text[j]) {
-      --bracket_depth;
-
-      if (!bracket_depth) {
-        /* GG we found it */
-        op->n = n;
-        return 1;
-      }
-    } else if (OP_SKIP == op_type_from_c(src->text[j])) {
-      /* OP_SKIP are not registered */
-      n -= j_inc;
+  for (i = 0; i < src->len; ++i) {
+    if (OP_SKIP != op_type_from_c(src->text[i])) {
+      ++count;
     }
   }
 
-  log_error(src, "No delimiter(%c) for %c", delim, c);
-  return 0;
+  return count;
 }
 
 /*
- * Analyzes the current character in `src->text` and updates `op` for that character.
- *
- * Modifies `src->i` as seen fit, preparing for the next `update_op_from_c()`.
- *
- * Modifies `op->src_i` to *EVENTUALLY* point to the correct `src->i`.
- *
- * If `op->type` is not `OP_INVALID` and `c` is not of the same type,
- * we avoid lexing it because a new `Op` needs to be created.
- *
- * On success, returns if above calling code should break and start lexing a new
- * `Op`.
- *
- * On failure, returns `-1`, state of `src->i` is unchanged.
+ * Returns what the character `c` of an op of `type` adds to its `n`.
  */
-static int update_op_from_c(Source* src, Op* op) {
-  const char c = src->text[src->i];
-  OpType type = op_type_from_c(c);
-  int should_break = 0;
-  int success = 1;
-
-  /* First time updating. */
-  if (OP_INVALID == op->type) {
-    assert(!op->n); /* Must be reset if OP_INVALID. */
-    op->src_start = src->i;
-
-    switch (type) {
-    case OP_SKIP:
-      goto done_; /* We ignore these */
-
-    case OP_IF_NOT_0:
-    case OP_IF_0:
-      assert('[' == c || ']' == c);
-      success = find_delimiter_for_if(src, op);
-      if (!success) {
-        return -1;
-      }
-
-      should_break = 1; /* We don't want to accumalate them */
-      break;
-
-    case OP_MUTATE:
-      assert('+' == c || '-' == c);
-      op->n = c == '+' ? 1 : -1;
-      break;
-
-    case OP_MOVE:
-      assert('>' == c || '<' == c);
-      op->n = c == '>' ? 1 : -1;
-      break;
-
-    case OP_PRINT:
-    case OP_INPUT:
-      op->n = 1;
-      break;
-
-    default:
-      assert(0); /* Unknown OP. */
-      break;
-    }
-
-    op->type = type;
-
-    goto done_;
-  }
-
-  if (type != op->type) {
-    /* TODO: Test this more rigorously */
-    if (OP_SKIP == op->type) {
-      /* But, we can just skip the OP_SKIP */
-      goto done_;
-    }
-    /* Means we need to start lexing a new Op */
-    return 1;
-  }
-
+static int n_from_c(const OpType type, const char c) {
   switch (type) {
   case OP_MUTATE:
     assert('+' == c || '-' == c);
-    op->n += c == '+' ? 1 : -1;
-    break;
+    return c == '+' ? 1 : -1;
 
   case OP_MOVE:
     assert('>' == c || '<' == c);
-    op->n += c == '>' ? 1 : -1;
-    break;
+    return c == '>' ? 1 : -1;
 
-  case OP_INPUT:
   case OP_PRINT:
-    ++op->n;
-    break;
+  case OP_INPUT:
+    return 1;
 
-  case OP_IF_0:
-  case OP_IF_NOT_0:
-    assert(0); /* Should not have gotten here with the OP_IF_* */
-    break;
   default:
-    assert(0); /* Unknown OP. */
-    break;
+    assert(0); /* Only these accumulate. */
+    return 0;
   }
-
-done_:
-  ++src->i;
-  return should_break;
 }
 
 /*
- * Analyzes `src->text` and constructs a full `Op` from as many related characters
- * as possible. For example `++----` would group into an `OP_MUTATE` with `n=-2`.
+ * Adds the bracket at `src->i` to `ops`, matching a `]` with the latest `[`
+ * that is still open, see `link_bracket()`.
  *
- * Modifies `src->i` as seen fit, preparing for the next `tokenize_one_op()`.
- *
- * On success, returns `1`, and sets `*op_ptr` to `NULL` if `src->i` is at the end, or sets it to
- * some valid `Op` for the sequence of operations we lexed.
+ * `OP_SKIP` is ignored because we can do so in this stage and it will
+ * prevent more complicated computation later due to getting rid of them.
  *
- * On failure, returns `0`.
+ * On failure, returns `0` if there's no `[` for a `]`.
  */
-static int lex_one_op(Source* src, Op** op_ptr) {
-  Op* op = NULL;
-  int success = 1;
-
-  if (src->i >= src->len) {
-    assert(src->i == src->len);
-    *op_ptr = NULL;
-    return 1;
-  }
-
-  /* Reset op */
-  op = malloc(sizeof (Op));
-  reset_op(op);
-
-  for (/* Already initialized */; src->i < src->len; /* Inside */) {
-    int should_break = update_op_from_c(src, op);
-    
-    if (-1 == should_break) {
-      success = 0;
-      goto nothing_;
-    }
+static int lex_bracket(const Source* src, Ops* ops, int* open) {
+  const char c = src->text[src->i];
+  const OpType type = op_type_from_c(c);
+  int i = 0;
 
-    if (should_break) {
-      op->src_end = src->i;
-      break;
-    }
-  }
+  assert('[' == c || ']' == c); /* Otherwise no point in calling this. */
 
-  if (OP_INVALID == op->type) {
-    assert(src->i >= src->len); /* Should be the only scenario where we still have OP_INVALID. */
-    goto nothing_;
+  if (OP_IF_NOT_0 == type && -1 == *open) {
+    log_error(src, "No delimiter(%c) for %c", '[', c);
+    return 0;
   }
 
-  log_debug(
-    src, "lexer: Op{type=%s, n=%i, start=%i, end=%i}",
-    str_from_op_type(op->type), op->n, op->src_start, op->src_end
-  );
+  i = push_op(ops, type, 0, src->i, src->i + 1);
+  link_bracket(ops, i, open);
 
-  goto done_;
+  return 1;
+}
 
-nothing_:
-  if (op) {
-    free(op);
-    op = NULL;
+int lex(Source* src, Arena* arena, Ops* ops) {
+  /* The latest `[` that is still open */
+  int open = -1;
+  /* The op that the next character continues, if it's of the same type */
+  int last = -1;
+  OpType type = OP_INVALID;
+  int i = 0;
+
+  if (!create_ops(ops, arena, count_commands(src))) {
+    log_error(src, "Out of memory for lexing");
+    return 0;
   }
 
-done_:
-  *op_ptr = op;
-  return success;
-}
+  for (src->i = 0; src->i < src->len; ++src->i) {
+    type = op_type_from_c(src->text[src->i]);
 
-int lex(Source* src, Op** first_op_ptr) {
-  Op* first_op = NULL;
-  Op* last_op = NULL; /* To know from where to push the next */
-  Op* current_op = NULL; /* For iteration */
-  int success = 0;
+    switch (type) {
+    case OP_SKIP:
+      /* Only consecutive characters are grouped */
+      last = -1;
+      break;
 
-  while (1) {
-    success = lex_one_op(src, &current_op);
-    if (!current_op) {
+    case OP_IF_0:
+    case OP_IF_NOT_0:
+      if (!lex_bracket(src, ops, &open)) {
+        return 0;
+      }
+      /* We don't want to accumalate them */
+      last = -1;
       break;
-    }
 
-    if (!first_op) {
-      /* current_op is the actual first */
-      first_op = current_op;
-      last_op = current_op;
-    } else {
-      /* current_op is appended */
-      last_op->next = current_op;
-      last_op = current_op;
+    default:
+      if (-1 != last && type == ops->types[last]) {
+        ops->ns[last] += n_from_c(type, src->text[src->i]);
+        ops->spans[last].src_end = src->i + 1;
+      } else {
+        last = push_op(ops, type, n_from_c(type, src->text[src->i]), src->i, src->i + 1);
+      }
+      break;
     }
+  }
 
-    if (!success) {
-      goto failure_;
+  if (-1 != open) {
+    /* The outermost one is the first in the source */
+    while (-1 != ops->matches[open]) {
+      open = ops->matches[open];
     }
+    src->i = ops->spans[open].src_start;
+    src->i_end = 0;
+    log_error(src, "No delimiter(%c) for %c", ']', '[');
+    return 0;
   }
 
-  goto done_;
-
-failure_:
-  if (first_op) {
-    free_ops(first_op);
-    first_op = NULL;
+  for (i = 0; i < ops->len; ++i) {
+    set_source_i(src, ops, i);
+    log_debug(
+      src, "lexer: Op{type=%s, n=%i, start=%i, end=%i}",
+      str_from_op_type(ops->types[i]), ops->ns[i],
+      ops->spans[i].src_start, ops->spans[i].src_end
+    );
   }
 
-done_:
-  *first_op_ptr = first_op;
-  return success;
+  return 1;
 }
-
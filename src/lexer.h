@@ -5,10 +5,14 @@
 #include "op.h"
 
 /*
- * On success, returns `1` and sets `*first_op_ptr` to the first `Op` lexed.
+ * Lexes `src->text` into `*ops`, allocated from `arena`. Consecutive
+ * characters of the same kind are grouped into one op, for example `++----`
+ * would group into an `OP_MUTATE` with `n=-2`.
+ *
+ * On success, returns `1`.
  *
  * On failure, returns `0`.
  */
-int lex(Source* src, Op** first_op_ptr);
+int lex(Source* src, Arena* arena, Ops* ops);
 
 #endif /* ifndef BFC_LEXER_H */
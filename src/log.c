@@ -6,9 +6,7 @@
 
 void bfc_log(FILE* f, const LogLevel level, const Source* src, const char* fmt, va_list args){
   const char* level_str = NULL;
-  int line = 1;
-  int column = 1;
-  int i = 0;
+  int line = 0;
 
   if (level > LOG_LEVEL_MAX) {
     return;
@@ -38,20 +36,14 @@ void bfc_log(FILE* f, const LogLevel level, const Source* src, const char* fmt,
   fprintf(f, "%s: ", level_str);
 
   if (src) {
-    for (i = 0; i < src->i; ++i, ++column) {
-      if ('\n' == src->text[i]) {
-        ++line;
-        column = 0;
-      }
-    }
-  
-    fprintf(f, "%s:%i:%i: ", src->path, line, column);
+    line = get_source_line(src, src->i);
+    fprintf(f, "%s:%i:%i: ", src->path, line + 1, src->i - src->line_starts[line] + 1);
   }
 
   vfprintf(f, fmt, args);
   putc('\n', f);
 
-  if (src->i_end > src->i) {
+  if (src && src->i_end > src->i) {
     assert(src->i < src->len);
     fprintf(f, "\t%.*s\n", src->i_end - src->i, src->text + src->i);
   }
@@ -69,7 +61,7 @@ void log_debug(const Source* src, const char* fmt, ...) {
   va_list args;
 
   va_start(args, fmt);
-  bfc_log(stdout, LOG_LEVEL_DEBUG, src, fmt, args);
+  bfc_log(stderr, LOG_LEVEL_DEBUG, src, fmt, args);
   va_end(args);
 }
 
@@ -77,7 +69,14 @@ void log_warn(const Source* src, const char* fmt, ...) {
   va_list args;
 
   va_start(args, fmt);
-  bfc_log(stdout, LOG_LEVEL_WARN, src, fmt, args);
+  bfc_log(stderr, LOG_LEVEL_WARN, src, fmt, args);
   va_end(args);
 }
 
+void log_info(const Source* src, const char* fmt, ...) {
+  va_list args;
+
+  va_start(args, fmt);
+  bfc_log(stderr, LOG_LEVEL_INFO, src, fmt, args);
+  va_end(args);
+}
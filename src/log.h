@@ -26,6 +26,8 @@ void log_error(const Source* src, const char* fmt, ...);
 
 void log_warn(const Source* src, const char* fmt, ...);
 
+void log_info(const Source* src, const char* fmt, ...);
+
 void log_debug(const Source* src, const char* fmt, ...);
 
 #endif /* ifndef BFC_LOG_H */
@@ -1,16 +1,79 @@
 #include "op.h"
+#include "parameters.h"
 
 #include <assert.h>
-#include <stdlib.h>
-
-void reset_op(Op* op) {
-  op->next = NULL;
-  op->type = OP_INVALID;
-  op->src_start = -1;
-  /* 0 because of Source.i_end spec */
-  op->src_end = 0;
-  op->n = 0;
-  op->code = NULL_IO_BUF;
+
+int create_ops(Ops* ops, Arena* arena, int capacity) {
+  ops->types = arena_alloc(arena, capacity * sizeof (*ops->types));
+  ops->ns = arena_alloc(arena, capacity * sizeof (*ops->ns));
+  ops->offsets = arena_alloc(arena, capacity * sizeof (*ops->offsets));
+  ops->matches = arena_alloc(arena, capacity * sizeof (*ops->matches));
+  ops->spans = arena_alloc(arena, capacity * sizeof (*ops->spans));
+  ops->len = 0;
+  ops->capacity = capacity;
+
+  return ops->types && ops->ns && ops->offsets && ops->matches && ops->spans;
+}
+
+int push_op(Ops* ops, OpType type, int n, int src_start, int src_end) {
+  const int i = ops->len;
+
+  assert(ops->len < ops->capacity);
+
+  ops->types[i] = type;
+  ops->ns[i] = n;
+  ops->offsets[i] = 0;
+  ops->matches[i] = -1;
+  ops->spans[i].src_start = src_start;
+  ops->spans[i].src_end = src_end;
+  ++ops->len;
+
+  return i;
+}
+
+void copy_op(Ops* ops, int to, int from) {
+  ops->types[to] = ops->types[from];
+  ops->ns[to] = ops->ns[from];
+  ops->offsets[to] = ops->offsets[from];
+  ops->spans[to] = ops->spans[from];
+}
+
+void link_bracket(Ops* ops, int i, int* open) {
+  int match = 0;
+
+  if (OP_IF_0 == ops->types[i]) {
+    /* The open brackets are a stack linked through their matches */
+    ops->matches[i] = *open;
+    *open = i;
+    return;
+  }
+
+  assert(OP_IF_NOT_0 == ops->types[i]);
+  assert(-1 != *open); /* Brackets must be balanced */
+
+  match = *open;
+  *open = ops->matches[match];
+  ops->matches[match] = i;
+  ops->matches[i] = match;
+}
+
+int divide_bytes(unsigned char* byte, int divisor, int copy) {
+  unsigned char* d = byte + divisor;
+  const int n = d[0] ? d[0] : MAX_BF_BYTE + 1;
+
+  if (1 == d[0] || d[1] || d[3] || d[4]) {
+    return 0;
+  }
+
+  d[2] += *byte / n;
+  d[1] = *byte % n;
+  d[0] = n - d[1];
+  if (copy) {
+    byte[copy] += *byte;
+  }
+  *byte = 0;
+
+  return 1;
 }
 
 OpType op_type_from_c(const char c) {
@@ -50,20 +113,21 @@ const char* str_from_op_type(OpType type) {
     return "IF!0";
   case OP_SKIP:
     return "NOP";
+  case OP_CLEAR:
+    return "CLEAR";
+  case OP_MUL_ADD:
+    return "MULADD";
+  case OP_SCAN:
+    return "SCAN";
+  case OP_SET:
+    return "SET";
+  case OP_PRINT_CONST:
+    return "PRINTCONST";
+  case OP_CMP_ADD:
+    return "CMPADD";
+  case OP_DIVMOD:
+    return "DIVMOD";
   default:
     return "INVALID";
   };
 }
-
-void free_ops(Op* first_op) {
-  Op* current_op;
-
-  assert(first_op);
-
-  for (current_op = first_op; current_op; /* Inside */) {
-    Op* next = current_op->next;
-    free(current_op);
-    current_op = next;
-  }
-}
-
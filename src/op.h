@@ -1,7 +1,7 @@
 #ifndef BFC_OP_H
 #define BFC_OP_H
 
-#include "io_buf.h"
+#include "arena.h"
 
 typedef enum {
   /* NULL equivalent for OpType */
@@ -20,24 +20,46 @@ typedef enum {
   /* n = How many bytes to print */
   OP_PRINT,
   
+  /* `Ops.matches` has the index to jump to, `n` is unused */
+  OP_IF_0,
+  /* `Ops.matches` has the index to jump to, `n` is unused */
+  OP_IF_NOT_0,
+
+  /* Sets the byte to 0, what `[-]` and `[+]` do */
+  OP_CLEAR,
   /*
-   * During lexing `n` = How many operations in code to jump.
-   * After normalization `n` = How many `Op` to jump.
+   * n = Factor, adds the byte times `n` to the byte at `offset`.
+   * What a loop like `[->++<]` does before it clears the byte.
    */
-  OP_IF_0,
+  OP_MUL_ADD,
   /*
-   * During lexing `n` = How many operations in code to jump.
-   * After normalization `n` = How many `Op` to jump.
+   * n = Stride, moves by `n` bytes until the byte is 0.
+   * What a loop like `[>>>>]` does.
    */
-  OP_IF_NOT_0,
+  OP_SCAN,
+  /*
+   * n = Value, sets the byte at `offset` to it.
+   * What `[-]+++++` does, once the optimizer knows the byte's value.
+   */
+  OP_SET,
+  /*
+   * n = How many bytes to print, like `OP_PRINT`, but the byte is known at
+   * compile-time, it's in `Ops.offsets`.
+   */
+  OP_PRINT_CONST,
+  /*
+   * n = Amount, adds it to the byte at `offset` if the byte isn't 0.
+   * What a loop like `[>+<[-]]` does before it clears the byte.
+   */
+  OP_CMP_ADD,
+  /*
+   * n = Offset of the divisor, divides the byte by it, copying it to `offset`.
+   * What the `-` of `[->-[>+>>]>[+[-<+>]>+>>]<<<<<]` does, see `divide_bytes()`.
+   */
+  OP_DIVMOD,
 } OpType;
 
-typedef struct Op {
-  /* NULL means no next */
-  struct Op* next;
-  
-  OpType type;
-
+typedef struct {
   /*
    * First index in source code where it starts.
    */
@@ -46,38 +68,93 @@ typedef struct Op {
    * Index of the terminating character for this `Op`.
    */
   int src_end;
+} OpSpan;
+
+/*
+ * The ops of a program, as parallel arrays indexed by the op, so passes
+ * over them walk memory sequentially.
+ *
+ * All of them live in an `Arena`, and are allocated once for as many ops as
+ * the program can have, every pass only ever keeps or shrinks them.
+ */
+typedef struct {
+  /*
+   * `OpType` of each op.
+   */
+  unsigned char* types;
 
   /*
    * Depends on type and stage, read OpType.
    */
-  int n;
+  int* ns;
 
   /*
-   * Relevant only for assembly.
-   * Virtual-address in executable where the operation starts.
-   *
-   * NOTE: Operation may be any amount of bytes, and can be variable even
-   * for the same `type`, if presented with optimization opportunities.
+   * Relative to the current byte, for types that touch other bytes, see
+   * `OpType`.
    */
-  /* int vaddress; */
+  int* offsets;
 
   /*
-   * For the assembler, at first is uninitialized.
-   *
-   * The assembler writes the machine code here
+   * Index of the matching bracket, for `OP_IF_0` and `OP_IF_NOT_0`.
    */
-  IoBuf code;
-} Op;
+  int* matches;
+
+  /*
+   * Only needed for diagnostics, so kept aside.
+   */
+  OpSpan* spans;
+
+  int len;
+  int capacity;
+} Ops;
+
+/*
+ * Allocates room for `capacity` ops from `arena`.
+ *
+ * Returns `0` if out of memory.
+ */
+int create_ops(Ops* ops, Arena* arena, int capacity);
+
+/*
+ * Appends an op, asserting there's room for it.
+ *
+ * Returns its index.
+ */
+int push_op(Ops* ops, OpType type, int n, int src_start, int src_end);
+
+/*
+ * Copies the op at `from` to `to`, other than its match.
+ */
+void copy_op(Ops* ops, int to, int from);
 
 /*
- * Sets `op` to 0 equivalents, predominantly `type` is set to `OP_INVALID`
+ * For passes that rewrite `ops` in place, call it after writing a bracket
+ * to `i`, in order. Matches it with its bracket through `*open`, the latest
+ * bracket that is still open, which starts as `-1`.
  */
-void reset_op(Op* op);
+void link_bracket(Ops* ops, int i, int* open);
+
+/*
+ * Does what `OP_DIVMOD` does at once to `byte`, with the divisor at `divisor`
+ * and the copy at `copy`, which must all be in the tape. `OP_DIVMOD` replaces
+ * the `-` right after the [ of the divmod loop, or of one with its pointer
+ * offsets shifted by `divisor`, and `copy` is 0 unless the loop also adds
+ * the byte to the one there.
+ *
+ * The bytes are in the shape for it if the divisor isn't 1, and the byte
+ * after it and the two after the quotient are 0. Then the byte is divided
+ * by the divisor, with 0 meaning one past `MAX_BF_BYTE`, the quotient is
+ * added to the byte at `divisor + 2`, the byte at `divisor + 1` is set to
+ * the remainder and the divisor to itself minus it, and the byte is added
+ * to the one at `copy` and cleared, so the loop is done.
+ *
+ * Returns `1` if it did, `0` if the bytes aren't in the shape for it, then
+ * nothing changed and the op subtracts 1 like the `-` it replaces.
+ */
+int divide_bytes(unsigned char* byte, int divisor, int copy);
 
 OpType op_type_from_c(const char c);
 
 const char* str_from_op_type(OpType type);
 
-void free_ops(Op* ops);
-
 #endif /* ifndef BFC_OP_H */
@@ -8,190 +8,1302 @@
 #include <stddef.h>
 #include <stdlib.h>
 
+static int should_prune(const Ops* ops, int i) {
+  switch (ops->types[i]) {
+  case OP_MOVE:
+  case OP_MUTATE:
+    if (!ops->ns[i]) {
+      return 1;
+    }
+    break;
+
+  /* TODO: More */
+
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static int is_mergeable(const OpType type) {
+  switch (type) {
+  case OP_MUTATE:
+  case OP_MOVE:
+  case OP_INPUT:
+  case OP_PRINT:
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+/* We use it twice so just to avoid duplication */
+#define LOG_PRUNE(SRC, OPS, I) \
+  do { \
+    set_source_i((SRC), (OPS), (I)); \
+    log_warn(SRC, "optimizer: %s sequence evaluates to NOP here.", str_from_op_type((OPS)->types[(I)])); \
+  } while (0)
+
 /*
- * Merges operations that are next to each other and are identical.
+ * Merges operations that are next to each other and are identical, and
+ * prunes operations that are useless to keep.
  * Situations like this can happen as a result of pruning some instructions,
- * causing separated ones to now become paired.
+ * causing separated ones to now become paired, like `+>-<+`.
  *
- * Returns the amount of merges, i.e. how many ops were merged and removed.
+ * Every kept op is written over the ops that were already read, so it's a
+ * single pass, and whatever it leaves last can always be merged with the next.
  *
- * The reason it's not `Op**` is because we merge to the right,
- * so it's guaranteed that the first `Op` always remains.
+ * Returns how many ops were merged or pruned.
  */
-static int merge_ops(Source* src, Op* ops) {
-  Op* op = NULL;
-  Op* next = NULL;
-  Op* tmp_op = NULL;
-  int merges_n = 0;
+static int merge_and_prune_ops(Source* src, Ops* ops) {
+  int open = -1;
+  int kept_n = 0;
+  int removed_n = 0;
+  int last = 0;
+  int i = 0;
 
-  if (!ops) {
-    return 0;
+  for (i = 0; i < ops->len; ++i) {
+    last = kept_n - 1;
+
+    if (
+      kept_n && ops->types[last] == ops->types[i]
+      && is_mergeable((OpType)ops->types[i])
+    ) {
+      ++removed_n;
+      set_source_i(src, ops, i);
+      log_debug(src, "optimizer: Merging this %s sequence into previous sequence.", str_from_op_type(ops->types[i]));
+
+      ops->ns[last] += ops->ns[i];
+      ops->spans[last].src_end = ops->spans[i].src_end;
+
+      if (should_prune(ops, last)) {
+        LOG_PRUNE(src, ops, last);
+        ++removed_n;
+        --kept_n;
+      }
+      continue;
+    }
+
+    if (should_prune(ops, i)) {
+      LOG_PRUNE(src, ops, i);
+      ++removed_n;
+      continue;
+    }
+
+    copy_op(ops, kept_n, i);
+    if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+      link_bracket(ops, kept_n, &open);
+    }
+    ++kept_n;
   }
 
-  for (op = ops; op && op->next; op = next) {
-    if (op->next->type == op->type) {
-      switch (op->type) {
-      case OP_MUTATE:
-      case OP_MOVE:
-      case OP_INPUT:
-      case OP_PRINT:
-        ++merges_n;
-        set_source_i(src, op->next);
-        log_debug(src, "optimizer: Merging this %s sequence into previous sequence.", str_from_op_type(op->type));
-
-        op->n += op->next->n;
-        op->src_end = op->next->src_end;
-        tmp_op = op->next;
-        op->next = op->next->next;
-        free(tmp_op);
-        break;
+  ops->len = kept_n;
+  return removed_n;
+}
+
+static void warn_overflows(Source* src, const Ops* ops) {
+  int i = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    switch (ops->types[i]) {
+    case OP_MOVE:
+    case OP_MUTATE:
+      set_source_i(src, ops, i);
+
+      if (ops->ns[i] > MAX_BF_BYTE || ops->ns[i] < -MAX_BF_BYTE) {
+        log_warn(src, "optimizer: %s sequence causes overflow(%d).", str_from_op_type(ops->types[i]), ops->ns[i]);
+
+        if (G_PARAMETERS.overflow_behavior == OVERFLOW_BEHAVIOR_ABORT) {
+          log_warn(src, "optimizer: Regarding above warning, this guarantees eventual abort due to the configured overflow behavior");
+        }
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+}
+
+/* How many different bytes a loop may touch for `replace_mul_loops()` to consider it */
+#define MAX_MUL_LOOP_BYTES (32)
+
+/*
+ * Returns `n` modulo the byte size, as the value closest to `0`,
+ * for example with 8-bit bytes `255` becomes `-1`.
+ */
+static int wrap_byte(const int n) {
+  int wrapped = n & MAX_BF_BYTE;
+
+  return wrapped > MAX_BF_BYTE / 2 + 1 ? wrapped - MAX_BF_BYTE - 1 : wrapped;
+}
+
+/*
+ * Returns the `m` for which `n * m` is `1` modulo the byte size, for an odd `n`.
+ *
+ * A loop that adds an odd `n` to its byte each iteration then runs exactly
+ * the byte times `invert_byte(-n)` times, wrapping around as often as needed.
+ */
+static int invert_byte(const int n) {
+  const unsigned long wrapped = n & MAX_BF_BYTE;
+  unsigned long inverse = wrapped;
+
+  assert(wrapped & 1);
+
+  /* Every step doubles how many low bits are right, starting from 3 */
+  while (1 != ((wrapped * inverse) & MAX_BF_BYTE)) {
+    inverse = (inverse * (2 - wrapped * inverse)) & MAX_BF_BYTE;
+  }
+
+  return (int)inverse;
+}
+
+/*
+ * Checks if the loop that starts at `if_0` is made only of `OP_MUTATE` and
+ * `OP_MOVE`, ends on the byte it started on, and changes that byte by an odd
+ * amount each iteration. Such a loop runs a known multiple of the byte times,
+ * see `invert_byte()`, so it's just multiplications followed by a clear.
+ *
+ * On success, returns `1`, and sets `offsets[i]` and `deltas[i]` to what the
+ * loop adds to each of the `*bytes_n` bytes it touches, where `offsets[0]` is
+ * always the loop's own byte.
+ *
+ * On failure, returns `0`.
+ */
+static int analyze_mul_loop(const Ops* ops, int if_0, int* offsets, int* deltas, int* bytes_n) {
+  int offset = 0;
+  int i = 0;
+  int j = 0;
+
+  assert(OP_IF_0 == ops->types[if_0]);
+
+  offsets[0] = 0;
+  deltas[0] = 0;
+  *bytes_n = 1;
+
+  for (i = if_0 + 1; OP_IF_NOT_0 != ops->types[i]; ++i) {
+    if (OP_MOVE == ops->types[i]) {
+      offset += ops->ns[i];
+      continue;
+    }
+    if (OP_MUTATE != ops->types[i]) {
+      return 0;
+    }
+
+    for (j = 0; j < *bytes_n && offsets[j] != offset; ++j);
+    if (j == *bytes_n) {
+      if (MAX_MUL_LOOP_BYTES == *bytes_n) {
+        return 0;
+      }
+      offsets[j] = offset;
+      deltas[j] = 0;
+      ++*bytes_n;
+    }
+    deltas[j] += ops->ns[i];
+  }
+
+  return !offset && (deltas[0] & 1);
+}
+
+/*
+ * Replaces loops like `[-]` with `OP_CLEAR`, and loops like `[->+>++<<]` with
+ * `OP_MUL_ADD`s followed by an `OP_CLEAR`, see `analyze_mul_loop()`.
+ *
+ * There are always enough ops in the loop for its replacement, at least one
+ * per byte and the brackets, so it's written over the ops that were read.
+ *
+ * Returns how many loops were replaced.
+ */
+static int replace_mul_loops(Source* src, Ops* ops) {
+  int offsets[MAX_MUL_LOOP_BYTES];
+  int deltas[MAX_MUL_LOOP_BYTES];
+  int bytes_n = 0;
+  int replaces_n = 0;
+  int open = -1;
+  int kept_n = 0;
+  OpSpan span;
+  /* How many times the loop runs per unit of its byte */
+  int factor = 0;
+  int i = 0;
+  int j = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    if (
+      OP_IF_0 != ops->types[i]
+      || !analyze_mul_loop(ops, i, offsets, deltas, &bytes_n)
+    ) {
+      copy_op(ops, kept_n, i);
+      if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+        link_bracket(ops, kept_n, &open);
+      }
+      ++kept_n;
+      continue;
+    }
+
+    ++replaces_n;
+    span.src_start = ops->spans[i].src_start;
+    span.src_end = ops->spans[ops->matches[i]].src_end;
+    src->i = span.src_start;
+    src->i_end = span.src_end;
+    log_debug(src, "optimizer: Replacing this loop with %i multiplications and a clear.", bytes_n - 1);
+
+    factor = invert_byte(-deltas[0]);
+    i = ops->matches[i];
+
+    for (j = 1; j < bytes_n; ++j) {
+      if (!wrap_byte(deltas[j])) {
+        continue;
+      }
+
+      ops->types[kept_n] = OP_MUL_ADD;
+      ops->ns[kept_n] = wrap_byte(factor * deltas[j]);
+      ops->offsets[kept_n] = offsets[j];
+      ops->spans[kept_n] = span;
+      ++kept_n;
+    }
+
+    ops->types[kept_n] = OP_CLEAR;
+    ops->ns[kept_n] = 0;
+    ops->offsets[kept_n] = 0;
+    ops->spans[kept_n] = span;
+    ++kept_n;
+  }
+
+  ops->len = kept_n;
+  return replaces_n;
+}
 
-      default:
+/*
+ * Replaces loops like `[>>>>]`, that only move, with `OP_SCAN`.
+ *
+ * Returns how many loops were replaced.
+ */
+static int replace_scan_loops(Source* src, Ops* ops) {
+  int replaces_n = 0;
+  int open = -1;
+  int kept_n = 0;
+  int i = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    if (
+      OP_IF_0 != ops->types[i] || i + 2 >= ops->len
+      || OP_MOVE != ops->types[i + 1] || OP_IF_NOT_0 != ops->types[i + 2]
+    ) {
+      copy_op(ops, kept_n, i);
+      if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+        link_bracket(ops, kept_n, &open);
+      }
+      ++kept_n;
+      continue;
+    }
+
+    ++replaces_n;
+    src->i = ops->spans[i].src_start;
+    src->i_end = ops->spans[i + 2].src_end;
+    log_debug(src, "optimizer: Replacing this loop with a scan of stride %i.", ops->ns[i + 1]);
+
+    ops->types[kept_n] = OP_SCAN;
+    ops->ns[kept_n] = ops->ns[i + 1];
+    ops->offsets[kept_n] = 0;
+    ops->spans[kept_n].src_start = ops->spans[i].src_start;
+    ops->spans[kept_n].src_end = ops->spans[i + 2].src_end;
+    ++kept_n;
+    i += 2;
+  }
+
+  ops->len = kept_n;
+  return replaces_n;
+}
+
+/*
+ * What `summarize_loops()` knows about a byte a loop touches, with `offset`
+ * relative to the loop's own byte.
+ */
+typedef struct {
+  int offset;
+  /* If it's cleared or set, it's known after the first iteration */
+  int set;
+  /* If other bytes are multiplied into it */
+  int multiplied;
+
+  /*
+   * While running the body, if `known` it's `value`, otherwise `value` is
+   * what was added to it since the iteration started.
+   */
+  int known;
+  int value;
+} LoopByte;
+
+static int find_loop_byte(const LoopByte* bytes, int bytes_n, int offset) {
+  int i = 0;
+
+  for (i = 0; i < bytes_n; ++i) {
+    if (bytes[i].offset == offset) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Returns the index of the byte at `offset` in `bytes`, adding it if it's
+ * not there yet, or `-1` if there's no room for it.
+ */
+static int add_loop_byte(LoopByte* bytes, int* bytes_n, int offset) {
+  int i = find_loop_byte(bytes, *bytes_n, offset);
+
+  if (-1 != i) {
+    return i;
+  }
+  if (MAX_MUL_LOOP_BYTES == *bytes_n) {
+    return -1;
+  }
+
+  i = (*bytes_n)++;
+  bytes[i].offset = offset;
+  bytes[i].set = 0;
+  bytes[i].multiplied = 0;
+  bytes[i].known = 0;
+  bytes[i].value = 0;
+  return i;
+}
+
+/*
+ * Runs the ops in `[start, end)` once over `bytes`, see `LoopByte`.
+ *
+ * Returns how many multiplications read a byte that wasn't known, the bytes
+ * they added to are no longer known either.
+ */
+static int run_loop_body(const Ops* ops, int start, int end, LoopByte* bytes, int bytes_n) {
+  LoopByte* source = NULL;
+  LoopByte* byte = NULL;
+  int unknown_reads_n = 0;
+  int offset = 0;
+  int i = 0;
+
+  for (i = start; i < end; ++i) {
+    switch (ops->types[i]) {
+    case OP_MOVE:
+      offset += ops->ns[i];
+      break;
+
+    case OP_MUTATE:
+      byte = bytes + find_loop_byte(bytes, bytes_n, offset);
+      byte->value = (byte->value + ops->ns[i]) & MAX_BF_BYTE;
+      break;
+
+    case OP_CLEAR:
+    case OP_SET:
+      byte = bytes + find_loop_byte(bytes, bytes_n, offset + ops->offsets[i]);
+      byte->known = 1;
+      byte->value = OP_SET == ops->types[i] ? ops->ns[i] & MAX_BF_BYTE : 0;
+      break;
+
+    case OP_MUL_ADD:
+      source = bytes + find_loop_byte(bytes, bytes_n, offset);
+      byte = bytes + find_loop_byte(bytes, bytes_n, offset + ops->offsets[i]);
+      if (!source->known) {
+        ++unknown_reads_n;
+        byte->known = 0;
         break;
       }
+      byte->value = (byte->value + source->value * ops->ns[i]) & MAX_BF_BYTE;
+      break;
+
+    default:
+      assert(0);
+      break;
     }
+  }
 
-    next = op->next;
+  return unknown_reads_n;
+}
+
+/*
+ * Checks if the loop body in `[start, end)` is straight-line code that ends
+ * on the byte it started on, changes that byte only by adding an odd
+ * `*delta` to it each iteration, and sets some other byte.
+ *
+ * Every iteration after the first then does exactly the same: the bytes it
+ * sets end up with the same values, the only bytes it multiplies from are
+ * ones it set, and the bytes it multiplies into get nothing more. What's
+ * left is bytes it only adds to, `bytes[i].value` each iteration.
+ *
+ * On success, returns `1`, and sets `bytes` to the `*bytes_n` bytes the loop
+ * touches, where `bytes[0]` is always the loop's own byte.
+ *
+ * On failure, returns `0`.
+ */
+static int analyze_summarized_loop(const Ops* ops, int start, int end, LoopByte* bytes, int* bytes_n, int* delta) {
+  int first_values[MAX_MUL_LOOP_BYTES];
+  int source = 0;
+  int byte = 0;
+  int set_n = 0;
+  int offset = 0;
+  int i = 0;
+
+  *bytes_n = 0;
+  add_loop_byte(bytes, bytes_n, 0);
+
+  for (i = start; i < end; ++i) {
+    switch (ops->types[i]) {
+    case OP_MOVE:
+      offset += ops->ns[i];
+      continue;
+
+    case OP_MUTATE:
+      byte = add_loop_byte(bytes, bytes_n, offset);
+      break;
+
+    case OP_CLEAR:
+    case OP_SET:
+      byte = add_loop_byte(bytes, bytes_n, offset + ops->offsets[i]);
+      if (-1 != byte) {
+        set_n += !bytes[byte].set;
+        bytes[byte].set = 1;
+      }
+      break;
+
+    case OP_MUL_ADD:
+      source = add_loop_byte(bytes, bytes_n, offset);
+      byte = add_loop_byte(bytes, bytes_n, offset + ops->offsets[i]);
+      if (!source || -1 == source) {
+        return 0;
+      }
+      if (-1 != byte) {
+        bytes[byte].multiplied = 1;
+      }
+      break;
+
+    default:
+      return 0;
+    }
+
+    if (-1 == byte) {
+      return 0;
+    }
+  }
+
+  /* Loops that only add are `replace_mul_loops()`'s */
+  if (offset || !set_n || bytes[0].set || bytes[0].multiplied) {
+    return 0;
+  }
+
+  /* The first iteration, where nothing is known yet */
+  run_loop_body(ops, start, end, bytes, *bytes_n);
+  *delta = bytes[0].value;
+  if (!(*delta & 1)) {
+    return 0;
+  }
+
+  for (i = 0; i < *bytes_n; ++i) {
+    if (bytes[i].set && !bytes[i].known) {
+      return 0;
+    }
+    first_values[i] = bytes[i].value;
+    if (!bytes[i].set) {
+      bytes[i].known = 0;
+      bytes[i].value = 0;
+    }
   }
 
-  return merges_n;
+  /* Any other iteration, which must only depend on what the first one set */
+  if (run_loop_body(ops, start, end, bytes, *bytes_n)) {
+    return 0;
+  }
+
+  for (i = 0; i < *bytes_n; ++i) {
+    if (bytes[i].set ? bytes[i].value != first_values[i] : bytes[i].multiplied && bytes[i].value) {
+      return 0;
+    }
+  }
+
+  return 1;
 }
 
-static int should_prune(const Op* op) {
-  assert(op);
+/*
+ * Replaces loops that `analyze_summarized_loop()` accepts, like
+ * `[->+>[-]+<<]` or `[--->[->+<]<]` once the inner loop is replaced, with a
+ * loop that always runs once: the body without the adds, the adds as
+ * multiplications of the loop's byte, and a clear of it. It's done at the
+ * ], over the body as already rewritten, so loops inside come first.
+ *
+ * The body loses at least one `OP_MUTATE` per multiplication, and one to the
+ * loop's own byte for the clear, so it's all written over the ops that were
+ * read.
+ *
+ * Returns how many loops were replaced.
+ */
+static int summarize_loops(Source* src, Ops* ops) {
+  LoopByte bytes[MAX_MUL_LOOP_BYTES];
+  OpSpan span;
+  int bytes_n = 0;
+  int replaces_n = 0;
+  int open = -1;
+  int kept_n = 0;
+  int body_end = 0;
+  int factor = 0;
+  int delta = 0;
+  int offset = 0;
+  int byte = 0;
+  int i = 0;
+  int j = 0;
 
-  switch (op->type) {
-  case OP_MOVE:
-  case OP_MUTATE:
-    if (!op->n) {
-      return 1;
+  for (i = 0; i < ops->len; ++i) {
+    if (
+      OP_IF_NOT_0 != ops->types[i]
+      || !analyze_summarized_loop(ops, open + 1, kept_n, bytes, &bytes_n, &delta)
+    ) {
+      copy_op(ops, kept_n, i);
+      if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+        link_bracket(ops, kept_n, &open);
+      }
+      ++kept_n;
+      continue;
     }
-    break;
 
-  /* TODO: More */
+    ++replaces_n;
+    span.src_start = ops->spans[open].src_start;
+    span.src_end = ops->spans[i].src_end;
+    src->i = span.src_start;
+    src->i_end = span.src_end;
+    log_debug(src, "optimizer: Replacing this loop with a single iteration of it.");
 
-  default:
-    break;
+    factor = invert_byte(-delta);
+    body_end = kept_n;
+    kept_n = open + 1;
+    offset = 0;
+
+    for (j = open + 1; j < body_end; ++j) {
+      if (OP_MOVE == ops->types[j]) {
+        offset += ops->ns[j];
+      } else if (OP_MUTATE == ops->types[j]) {
+        byte = find_loop_byte(bytes, bytes_n, offset);
+        if (!byte || (!bytes[byte].set && !bytes[byte].multiplied)) {
+          continue;
+        }
+      }
+      copy_op(ops, kept_n, j);
+      ++kept_n;
+    }
+
+    for (j = 1; j < bytes_n; ++j) {
+      if (bytes[j].set || bytes[j].multiplied || !bytes[j].value) {
+        continue;
+      }
+
+      ops->types[kept_n] = OP_MUL_ADD;
+      ops->ns[kept_n] = wrap_byte(factor * bytes[j].value);
+      ops->offsets[kept_n] = bytes[j].offset;
+      ops->spans[kept_n] = span;
+      ++kept_n;
+    }
+
+    ops->types[kept_n] = OP_CLEAR;
+    ops->ns[kept_n] = 0;
+    ops->offsets[kept_n] = 0;
+    ops->spans[kept_n] = span;
+    ++kept_n;
+
+    assert(kept_n <= body_end);
+    copy_op(ops, kept_n, i);
+    link_bracket(ops, kept_n, &open);
+    ++kept_n;
   }
 
-  return 0;
+  ops->len = kept_n;
+  return replaces_n;
 }
 
-/* We use it twice so just to avoid duplication */
-#define LOG_PRUNE(SRC, OP) \
-  do { \
-    set_source_i((SRC), (OP)); \
-    log_warn(SRC, "optimizer: %s sequence evaluates to NOP here.", str_from_op_type((OP)->type)); \
-  } while (0)
+/* How many bytes `CellFacts` keeps track of, past that it forgets */
+#define MAX_CELL_FACTS (32)
+/* How many ops a loop may have for `forget_loop_writes()` to look into it */
+#define MAX_SUMMARIZED_LOOP_OPS (256)
+/* What `get_known_byte()` returns for a byte whose value isn't known */
+#define UNKNOWN_BYTE (-1)
 
 /*
- * Finds operations that are useless to keep.
- * 
- * Returns how many times we pruned.
+ * What is known about the values of bytes, by offset from where
+ * `propagate_constants()` started.
+ *
+ * If `rest_zero` is set, every byte that isn't in `offsets` is 0, otherwise
+ * nothing is known about those.
  */
-static int prune_null_ops(Source* src, Op** ops) {
-  Op* op = NULL;
-  Op* next = NULL;
-  Op* previous = NULL;
-  Op* first_op = NULL;
-  int prunes_count = 0;
+typedef struct {
+  int rest_zero;
+  int offsets[MAX_CELL_FACTS];
+  /* Value of the byte at the same index of `offsets`, or `UNKNOWN_BYTE` */
+  int values[MAX_CELL_FACTS];
+  int n;
+} CellFacts;
 
-  /* There is special logic if we need to prune the first op. */
-  first_op = *ops;
-  while (first_op && should_prune(first_op)) {
-    LOG_PRUNE(src, first_op);
+static int find_cell_fact(const CellFacts* facts, int offset) {
+  int i = 0;
 
-    ++prunes_count;
-    next = first_op->next;
-    free(op);
-    first_op = next;
+  for (i = 0; i < facts->n; ++i) {
+    if (facts->offsets[i] == offset) {
+      return i;
+    }
   }
 
-  if (!first_op) {
-    goto done_;
+  return -1;
+}
+
+static int get_known_byte(const CellFacts* facts, int offset) {
+  const int i = find_cell_fact(facts, offset);
+
+  if (-1 != i) {
+    return facts->values[i];
   }
-  
-  assert(!should_prune(first_op)); /* Sanity check */
 
-  previous = first_op;
-  /* We have asserted that we can skip the first one */
-  for (op = first_op->next; op; op = next) {
-    next = op->next;
+  return facts->rest_zero ? 0 : UNKNOWN_BYTE;
+}
+
+static void forget_cell_facts(CellFacts* facts) {
+  facts->rest_zero = 0;
+  facts->n = 0;
+}
 
-    if (should_prune(op)) {
-      LOG_PRUNE(src, op);
-      
-      assert(previous); /* Must always exist. */
-      ++prunes_count;
-      previous->next = op->next;
-      free(op);
-    } else {
-      previous = op;
+/*
+ * Records that the byte at `offset` is `value`, or `UNKNOWN_BYTE`.
+ */
+static void set_known_byte(CellFacts* facts, int offset, int value) {
+  const int i = find_cell_fact(facts, offset);
+
+  if (-1 != i) {
+    facts->values[i] = value;
+  } else if (value != get_known_byte(facts, offset)) {
+    if (MAX_CELL_FACTS == facts->n) {
+      if (!facts->rest_zero) {
+        /* It just won't know this one */
+        return;
+      }
+      /* It can't list one more byte that isn't 0, so it knows of none that is */
+      forget_cell_facts(facts);
+      if (UNKNOWN_BYTE == value) {
+        return;
+      }
     }
+    facts->offsets[facts->n] = offset;
+    facts->values[facts->n] = value;
+    ++facts->n;
   }
+}
 
-done_:
-  *ops = first_op;
-  return prunes_count;
+/*
+ * Forgets the value of every byte the loop body from `start` to `end`
+ * (exclusive) can write, with the pointer at `offset` when it's entered.
+ *
+ * What is left then holds every time the body starts, and once the loop is
+ * done, as long as the body ends where it started, and so does any loop in
+ * it.
+ *
+ * Returns `1` if it does, otherwise `0`, and what is left can't be trusted.
+ */
+static int forget_loop_writes(CellFacts* facts, const Ops* ops, int start, int end, int offset) {
+  /* Where each loop around the current op was entered, within the body */
+  int entries[MAX_SUMMARIZED_LOOP_OPS / 2];
+  const int entry = offset;
+  int depth = 0;
+  int i = 0;
+
+  if (end - start > MAX_SUMMARIZED_LOOP_OPS) {
+    return 0;
+  }
+
+  for (i = start; i < end; ++i) {
+    switch (ops->types[i]) {
+    case OP_MOVE:
+      offset += ops->ns[i];
+      break;
+
+    case OP_MUTATE:
+    case OP_INPUT:
+    case OP_CLEAR:
+      set_known_byte(facts, offset, UNKNOWN_BYTE);
+      break;
+
+    case OP_SET:
+    case OP_MUL_ADD:
+      set_known_byte(facts, offset + ops->offsets[i], UNKNOWN_BYTE);
+      break;
+
+    case OP_SCAN:
+      return 0;
+
+    case OP_IF_0:
+      entries[depth++] = offset;
+      break;
+
+    case OP_IF_NOT_0:
+      if (entries[--depth] != offset) {
+        return 0;
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  return offset == entry;
 }
 
-static void warn_overflows(Source* src, Op* ops) {
-  Op* op;
+/*
+ * Follows the values of bytes that are known at compile-time, and rewrites
+ * the ops that depend on them.
+ *
+ * Every byte is 0 at the start of the program, a loop, a clear and a scan
+ * leave the byte they end on 0, and a loop keeps what is known about any
+ * byte it can't write. Then:
+ *
+ * - Loops that are never entered are removed, like the comment at the top of
+ *   a file that's wrapped in a loop so it doesn't run.
+ * - Additions to a known byte become `OP_SET`s, folded into a clear or set
+ *   right before them, so `[-]+++++` is a single store of 5.
+ * - Multiplications of a known byte into another known one become `OP_SET`s,
+ *   and ones of a 0 byte are removed, as are clears of a 0 byte.
+ * - Prints of a known byte become `OP_PRINT_CONST`s.
+ *
+ * Returns how many ops were removed or rewritten.
+ */
+static int propagate_constants(Source* src, Ops* ops) {
+  CellFacts facts;
+  int changed_n = 0;
+  int offset = 0;
+  int value = 0;
+  int target = 0;
+  int open = -1;
+  int kept_n = 0;
+  int last = 0;
+  int i = 0;
+
+  facts.rest_zero = 1;
+  facts.n = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    value = get_known_byte(&facts, offset);
+    last = kept_n - 1;
+
+    switch (ops->types[i]) {
+    case OP_IF_0:
+      if (!value) {
+        ++changed_n;
+        src->i = ops->spans[i].src_start;
+        src->i_end = ops->spans[ops->matches[i]].src_end;
+        log_debug(src, "optimizer: Removing this loop, it's never entered.");
+
+        i = ops->matches[i];
+        continue;
+      }
+
+      /* The body may run again after it changed anything */
+      if (!forget_loop_writes(&facts, ops, i + 1, ops->matches[i], offset)) {
+        forget_cell_facts(&facts);
+      }
+      break;
+
+    case OP_IF_NOT_0:
+      /* Same as when the loop was entered, or skipped, which its body kept */
+      if (!forget_loop_writes(&facts, ops, open + 1, kept_n, offset)) {
+        forget_cell_facts(&facts);
+      }
+      set_known_byte(&facts, offset, 0);
+      break;
 
-  for (op = ops; op; op = op->next) {
-    switch (op->type) {
     case OP_MOVE:
+      offset += ops->ns[i];
+      break;
+
     case OP_MUTATE:
-      set_source_i(src, op);
+      if (UNKNOWN_BYTE == value) {
+        break;
+      }
 
-      if (op->n > MAX_BF_BYTE || op->n < -MAX_BF_BYTE) {
-        log_warn(src, "optimizer: %s sequence causes overflow(%d).", str_from_op_type(op->type), op->n);
+      ++changed_n;
+      value = (value + ops->ns[i]) & MAX_BF_BYTE;
+      set_known_byte(&facts, offset, value);
+      set_source_i(src, ops, i);
+      log_debug(src, "optimizer: This byte is known to end up as %i here.", value);
 
-        if (G_PARAMETERS.overflow_behavior == OVERFLOW_BEHAVIOR_ABORT) {
-          log_warn(src, "optimizer: Regarding above warning, this guarantees eventual abort due to the configured overflow behavior");
+      if (
+        kept_n && !ops->offsets[last]
+        && (OP_CLEAR == ops->types[last] || OP_SET == ops->types[last])
+      ) {
+        /* Nothing read what it stored */
+        ops->types[last] = OP_SET;
+        ops->ns[last] = value;
+        ops->spans[last].src_end = ops->spans[i].src_end;
+        continue;
+      }
+
+      copy_op(ops, kept_n, i);
+      ops->types[kept_n] = OP_SET;
+      ops->ns[kept_n] = value;
+      ++kept_n;
+      continue;
+
+    case OP_INPUT:
+      set_known_byte(&facts, offset, UNKNOWN_BYTE);
+      break;
+
+    case OP_PRINT:
+      if (UNKNOWN_BYTE == value) {
+        break;
+      }
+
+      ++changed_n;
+      copy_op(ops, kept_n, i);
+      ops->types[kept_n] = OP_PRINT_CONST;
+      ops->offsets[kept_n] = value;
+      ++kept_n;
+      continue;
+
+    case OP_CLEAR:
+      if (!value) {
+        /* What's left of a loop `replace_mul_loops()` replaced */
+        ++changed_n;
+        set_source_i(src, ops, i);
+        log_debug(src, "optimizer: Removing this loop, it's never entered.");
+        continue;
+      }
+      set_known_byte(&facts, offset, 0);
+      break;
+
+    case OP_MUL_ADD:
+      if (!value) {
+        ++changed_n;
+        continue;
+      }
+
+      target = get_known_byte(&facts, offset + ops->offsets[i]);
+      if (UNKNOWN_BYTE == value || UNKNOWN_BYTE == target) {
+        set_known_byte(&facts, offset + ops->offsets[i], UNKNOWN_BYTE);
+        break;
+      }
+
+      ++changed_n;
+      target = (target + value * ops->ns[i]) & MAX_BF_BYTE;
+      set_known_byte(&facts, offset + ops->offsets[i], target);
+      copy_op(ops, kept_n, i);
+      ops->types[kept_n] = OP_SET;
+      ops->ns[kept_n] = target;
+      ++kept_n;
+      continue;
+
+    case OP_SCAN:
+      /* It moves by however much the tape says */
+      forget_cell_facts(&facts);
+      set_known_byte(&facts, offset, 0);
+      break;
+
+    default:
+      break;
+    }
+
+    copy_op(ops, kept_n, i);
+    if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+      link_bracket(ops, kept_n, &open);
+    }
+    ++kept_n;
+  }
+
+  ops->len = kept_n;
+  return changed_n;
+}
+
+/*
+ * Checks if the loop body in `[start, end)` ends on the byte it started on,
+ * clears that byte, and otherwise only adds to other bytes. Such a loop
+ * runs at most once, so it's just additions if the byte isn't 0.
+ *
+ * On success, returns `1`, and sets `bytes` to the `*bytes_n` bytes the loop
+ * touches, with what it adds to them, where `bytes[0]` is always the loop's
+ * own byte.
+ *
+ * On failure, returns `0`.
+ */
+static int analyze_if_loop(const Ops* ops, int start, int end, LoopByte* bytes, int* bytes_n) {
+  int offset = 0;
+  int byte = 0;
+  int i = 0;
+
+  *bytes_n = 0;
+  add_loop_byte(bytes, bytes_n, 0);
+
+  for (i = start; i < end; ++i) {
+    switch (ops->types[i]) {
+    case OP_MOVE:
+      offset += ops->ns[i];
+      break;
+
+    case OP_MUTATE:
+      byte = add_loop_byte(bytes, bytes_n, offset);
+      /* What's added to the loop's own byte after the clear would keep it going */
+      if (-1 == byte || (!byte && bytes[0].set)) {
+        return 0;
+      }
+      bytes[byte].value += ops->ns[i];
+      break;
+
+    case OP_CLEAR:
+      if (offset + ops->offsets[i]) {
+        return 0;
+      }
+      bytes[0].set = 1;
+      break;
+
+    default:
+      return 0;
+    }
+  }
+
+  return !offset && bytes[0].set;
+}
+
+/* Ops of a divmod loop after the `-` of its divisor, see `OP_DIVMOD` */
+static const struct {
+  OpType type;
+  int n;
+  int offset;
+} DIVMOD_LOOP_PATTERN[] = {
+  { OP_IF_0, 0, 0 },
+  { OP_MOVE, 1, 0 },
+  { OP_MUTATE, 1, 0 },
+  { OP_MOVE, 2, 0 },
+  { OP_IF_NOT_0, 0, 0 },
+  { OP_MOVE, 1, 0 },
+  { OP_IF_0, 0, 0 },
+  { OP_MUTATE, 1, 0 },
+  { OP_MUL_ADD, 1, -1 },
+  { OP_CLEAR, 0, 0 },
+  { OP_MOVE, 1, 0 },
+  { OP_MUTATE, 1, 0 },
+  { OP_MOVE, 2, 0 },
+  { OP_IF_NOT_0, 0, 0 },
+};
+#define DIVMOD_LOOP_PATTERN_N ((int)(sizeof (DIVMOD_LOOP_PATTERN) / sizeof (*DIVMOD_LOOP_PATTERN)))
+
+/*
+ * Checks if the loop body in `[start, end)` is the one of a divmod loop, see
+ * `OP_DIVMOD`, as ops, with a `-` of its byte, optionally a `>+` to copy it,
+ * and a `>-` of the divisor before the pattern, and the move back after it.
+ *
+ * On success, returns `1`, and sets `*divisor` and `*copy` to the offsets of
+ * the divisor and of where the byte is copied, `0` if it isn't.
+ *
+ * On failure, returns `0`.
+ */
+static int analyze_divmod_loop(const Ops* ops, int start, int end, int* divisor, int* copy) {
+  const int prefix_n = end - start - DIVMOD_LOOP_PATTERN_N - 1;
+  int i = start;
+  int j = 0;
+
+  if (
+    (3 != prefix_n && 5 != prefix_n)
+    || OP_MUTATE != ops->types[i] || -1 != wrap_byte(ops->ns[i])
+  ) {
+    return 0;
+  }
+  ++i;
+
+  *copy = 0;
+  if (5 == prefix_n) {
+    if (OP_MOVE != ops->types[i] || OP_MUTATE != ops->types[i + 1] || 1 != wrap_byte(ops->ns[i + 1])) {
+      return 0;
+    }
+    *copy = ops->ns[i];
+    i += 2;
+  }
+
+  if (OP_MOVE != ops->types[i] || OP_MUTATE != ops->types[i + 1] || -1 != wrap_byte(ops->ns[i + 1])) {
+    return 0;
+  }
+  *divisor = *copy + ops->ns[i];
+  i += 2;
+
+  /* The copy must be out of the way of the bytes the division uses */
+  if (*divisor < 1 || *copy < 0 || (*copy && *copy >= *divisor)) {
+    return 0;
+  }
+
+  for (j = 0; j < DIVMOD_LOOP_PATTERN_N; ++i, ++j) {
+    if (
+      ops->types[i] != DIVMOD_LOOP_PATTERN[j].type
+      || (
+        OP_IF_0 != ops->types[i] && OP_IF_NOT_0 != ops->types[i]
+        && wrap_byte(ops->ns[i]) != DIVMOD_LOOP_PATTERN[j].n
+      )
+      || (
+        (OP_MUL_ADD == ops->types[i] || OP_CLEAR == ops->types[i])
+        && ops->offsets[i] != DIVMOD_LOOP_PATTERN[j].offset
+      )
+    ) {
+      return 0;
+    }
+  }
+
+  return OP_MOVE == ops->types[i] && ops->ns[i] == -(*divisor + 4);
+}
+
+/*
+ * Replaces loops that `analyze_if_loop()` accepts, like the `y[x-y[-]]` that
+ * ends comparing `x` with `y`, with `OP_CMP_ADD`s followed by an `OP_CLEAR`,
+ * and turns the `-` that starts a loop `analyze_divmod_loop()` accepts into
+ * an `OP_DIVMOD`, which keeps the rest of the loop for when the bytes aren't
+ * what the idiom expects.
+ *
+ * It's done at the ], over the body as already rewritten, and there's at
+ * least one `OP_MUTATE` per `OP_CMP_ADD` and a clear in the loop, so it's
+ * written over the ops that were read.
+ *
+ * Returns how many loops were replaced.
+ */
+static int replace_idioms(Source* src, Ops* ops) {
+  LoopByte bytes[MAX_MUL_LOOP_BYTES];
+  OpSpan span;
+  int bytes_n = 0;
+  int replaces_n = 0;
+  int open = -1;
+  int kept_n = 0;
+  int divisor = 0;
+  int copy = 0;
+  int i = 0;
+  int j = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    if (OP_IF_NOT_0 == ops->types[i] && analyze_if_loop(ops, open + 1, kept_n, bytes, &bytes_n)) {
+      ++replaces_n;
+      span.src_start = ops->spans[open].src_start;
+      span.src_end = ops->spans[i].src_end;
+      src->i = span.src_start;
+      src->i_end = span.src_end;
+      log_debug(src, "optimizer: Replacing this loop with %i additions if the byte isn't 0.", bytes_n - 1);
+
+      kept_n = open;
+      open = ops->matches[open];
+
+      for (j = 1; j < bytes_n; ++j) {
+        if (!wrap_byte(bytes[j].value)) {
+          continue;
         }
+
+        ops->types[kept_n] = OP_CMP_ADD;
+        ops->ns[kept_n] = wrap_byte(bytes[j].value);
+        ops->offsets[kept_n] = bytes[j].offset;
+        ops->spans[kept_n] = span;
+        ++kept_n;
       }
+
+      ops->types[kept_n] = OP_CLEAR;
+      ops->ns[kept_n] = 0;
+      ops->offsets[kept_n] = 0;
+      ops->spans[kept_n] = span;
+      ++kept_n;
+      continue;
+    }
+
+    if (OP_IF_NOT_0 == ops->types[i] && analyze_divmod_loop(ops, open + 1, kept_n, &divisor, &copy)) {
+      ++replaces_n;
+      src->i = ops->spans[open].src_start;
+      src->i_end = ops->spans[i].src_end;
+      log_debug(src, "optimizer: This loop divides by the byte at %i, doing it at once when it can.", divisor);
+
+      ops->types[open + 1] = OP_DIVMOD;
+      ops->ns[open + 1] = divisor;
+      ops->offsets[open + 1] = copy;
+    }
+
+    copy_op(ops, kept_n, i);
+    if (OP_IF_0 == ops->types[kept_n] || OP_IF_NOT_0 == ops->types[kept_n]) {
+      link_bracket(ops, kept_n, &open);
+    }
+    ++kept_n;
+  }
+
+  ops->len = kept_n;
+  return replaces_n;
+}
+
+/*
+ * Where the pointer went within a loop, as offsets from where the program
+ * started.
+ */
+typedef struct {
+  int entry_offset;
+  int min_offset;
+  int max_offset;
+} LoopExtent;
+
+/*
+ * Finds how far left and right of where it starts the pointer can ever go,
+ * into `info`, and how far every loop takes it from where it's entered.
+ *
+ * A loop whose body moves by a fixed amount that isn't 0 wanders off by it
+ * every iteration, and so does a scan, so how far those go depends on the
+ * tape, which makes the extent of any loop around them, and of the program,
+ * unknown.
+ *
+ * On failure, returns `0` and leaves the extent unknown.
+ */
+static int find_tape_extent(Source* src, const Ops* ops, OptimizationInfo* info) {
+  /* Of every loop around the current op, innermost last */
+  LoopExtent* loops = NULL;
+  /* Of the whole program, it's the loop around everything */
+  LoopExtent* loop = NULL;
+  int depth = 0;
+  int offset = 0;
+  int known = 1;
+  int i = 0;
+
+  info->tape_extent_known = 0;
+
+  loops = malloc((ops->len / 2 + 1) * sizeof (LoopExtent));
+  if (!loops) {
+    return 0;
+  }
+  loops[0].entry_offset = 0;
+  loops[0].min_offset = 0;
+  loops[0].max_offset = 0;
+
+  for (i = 0; i < ops->len; ++i) {
+    loop = loops + depth;
+
+    switch (ops->types[i]) {
+    case OP_MOVE:
+      offset += ops->ns[i];
+      break;
+
+    case OP_MUL_ADD:
+    case OP_SET:
+    case OP_CMP_ADD:
+      if (offset + ops->offsets[i] < loop->min_offset) {
+        loop->min_offset = offset + ops->offsets[i];
+      }
+      if (offset + ops->offsets[i] > loop->max_offset) {
+        loop->max_offset = offset + ops->offsets[i];
+      }
+      break;
+
+    case OP_DIVMOD:
+      /* The bytes it reads at once, the loop after it gets there anyway */
+      if (offset + ops->ns[i] + 4 > loop->max_offset) {
+        loop->max_offset = offset + ops->ns[i] + 4;
+      }
+      break;
+
+    case OP_SCAN:
+      known = 0;
+      break;
+
+    case OP_IF_0:
+      ++depth;
+      loops[depth].entry_offset = offset;
+      loops[depth].min_offset = offset;
+      loops[depth].max_offset = offset;
+      break;
+
+    case OP_IF_NOT_0:
+      assert(depth > 0);
+      if (offset != loop->entry_offset) {
+        known = 0;
+      } else {
+        set_source_i(src, ops, ops->matches[i]);
+        log_debug(
+          src, "optimizer: This loop stays within %i to %i of where it's entered.",
+          loop->min_offset - loop->entry_offset, loop->max_offset - loop->entry_offset
+        );
+      }
+
+      --depth;
+      if (loop->min_offset < loops[depth].min_offset) {
+        loops[depth].min_offset = loop->min_offset;
+      }
+      if (loop->max_offset > loops[depth].max_offset) {
+        loops[depth].max_offset = loop->max_offset;
+      }
+      /* Then it goes on as if the loop left it where it was entered */
+      offset = loop->entry_offset;
       break;
 
     default:
       break;
     }
+
+    loop = loops + depth;
+    if (offset < loop->min_offset) {
+      loop->min_offset = offset;
+    }
+    if (offset > loop->max_offset) {
+      loop->max_offset = offset;
+    }
   }
+  assert(!depth);
+
+  if (known) {
+    info->tape_extent_known = 1;
+    info->min_offset = loops[0].min_offset;
+    info->max_offset = loops[0].max_offset;
+    log_debug(0, "optimizer: The pointer stays within %i to %i of where it starts.", info->min_offset, info->max_offset);
+  } else {
+    log_debug(0, "optimizer: How far the pointer goes depends on the tape.");
+  }
+
+  free(loops);
+  return 1;
 }
 
-static Op* find_first_input_op(Op* ops) {
-  Op* op;
+static int find_first_input_op(const Ops* ops) {
+  int i = 0;
 
-  for (op = ops; op; op = op->next) {
-    if (OP_INPUT == op->type) {
-      return op;
+  for (i = 0; i < ops->len; ++i) {
+    if (OP_INPUT == ops->types[i]) {
+      return i;
     }
   }
 
-  return NULL;
+  return -1;
 }
 
-OptimizationInfo optimize_ops(Source* src, Op** ops) {
+OptimizationInfo optimize_ops(Source* src, Ops* ops) {
   OptimizationInfo optimiziation_info = {
-    .first_input_op = NULL,
+    .first_input_op = -1,
     .overflow_ops = NULL,
+    .tape_extent_known = 0,
+    .min_offset = 0,
+    .max_offset = 0,
   };
-  int prunes_n = 0;
-  int merges_n = 0;
 
-  do {
-    prunes_n = prune_null_ops(src, ops);
-    merges_n = merge_ops(src, *ops);
-  } while (prunes_n || merges_n);
+  merge_and_prune_ops(src, ops);
 
-  optimiziation_info.first_input_op = find_first_input_op(*ops);
-  if (optimiziation_info.first_input_op) {
-    set_source_i(src, optimiziation_info.first_input_op);
+  replace_mul_loops(src, ops);
+  replace_scan_loops(src, ops);
+  if (summarize_loops(src, ops)) {
+    /* The adds that were taken out of the bodies leave moves next to each other */
+    merge_and_prune_ops(src, ops);
+  }
+
+  /* After the replacements, so clears and multiplications keep what's known */
+  if (propagate_constants(src, ops)) {
+    /* What was around removed loops may now be next to each other */
+    merge_and_prune_ops(src, ops);
+  }
+
+  /* Last, so none of the passes above has to know the ops it makes */
+  replace_idioms(src, ops);
+
+  optimiziation_info.first_input_op = find_first_input_op(ops);
+  if (-1 != optimiziation_info.first_input_op) {
+    set_source_i(src, ops, optimiziation_info.first_input_op);
     log_debug(src, "optimizer: All code up to here can be evaluated at compile-time.");
   } else {
     log_debug(src, "optimizer: The entire program can be evaluated at compile-time.");
   }
 
+  find_tape_extent(src, ops, &optimiziation_info);
+
   return optimiziation_info;
 }
-
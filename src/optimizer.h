@@ -5,11 +5,11 @@
 #include "source.h"
 
 /* TODO: Prune null OP_MUTATE and OP_MOVE, if their n is 0. */
-/* TODO: Optimize logical flows that are never reached. */
 
 typedef struct OpReference {
     struct OpReference* next;
-    Op* op;
+    /* Index of the op */
+    int op;
 } OpReference;
 
 /*
@@ -21,25 +21,35 @@ typedef struct OpReference {
  */
 typedef struct {
     /*
-     * If `NULL` there is none, then entire program can be evaluated at compile time
+     * If `-1` there is none, then entire program can be evaluated at compile time
      * into a single print call.
      *
-     * If valid, then everything up to that `Op` can be cached.
+     * If valid, then everything up to that op can be cached.
      */
-    Op* first_input_op;
+    int first_input_op;
 
     /*
      * Ops that are guaranteed to cause overflow
      */
     OpReference* overflow_ops;
+
+    /*
+     * If set, the pointer provably never leaves `[min_offset, max_offset]`,
+     * relative to where it starts, wherever the program goes.
+     */
+    int tape_extent_known;
+    int min_offset;
+    int max_offset;
 } OptimizationInfo;
 
 /*
- * Prunes ops that equate to `NOP`, like `Op`s that came from `<<>>` or `++--`.
+ * Prunes ops that equate to `NOP`, like ops that came from `<<>>` or `++--`.
  * Removes dead code, like brackets that are known to never execute.
  *
+ * Rewrites `ops` in place, it only ever gets shorter.
+ *
  * Returns additional information for assembly stage, see documentation for `OptimizationInfo`
  */
-OptimizationInfo optimize_ops(Source* src, Op** ops);
+OptimizationInfo optimize_ops(Source* src, Ops* ops);
 
 #endif /* ifndef BFC_OPTIMIZER_H */
@@ -3,5 +3,14 @@
 Parameters G_PARAMETERS = {
   .overflow_behavior = OVERFLOW_BEHAVIOR_UNDEFINED,
   .byte_size = 1,
+  .tape_size = 30000,
+  .max_tape_size = 1 << 30,
+  .prefault_tape = 0,
+  .output_buffer_size = 8192,
+  .line_buffered = 0,
+  .input_buffer_size = 65536,
+  .eof_behavior = EOF_BEHAVIOR_UNCHANGED,
+  .max_evaluation_steps = 10000000,
+  .simd_extension = SIMD_EXTENSION_SSE2,
 };
 
@@ -13,10 +13,46 @@ typedef enum {
   OVERFLOW_BEHAVIOR_ABORT,
 } OverflowBehavior;
 
+typedef enum {
+  /* Leave the cell as it was, what a bare `read` does. */
+  EOF_BEHAVIOR_UNCHANGED,
+  /* Set the cell to `0`. */
+  EOF_BEHAVIOR_ZERO,
+  /* Set the cell to `-1`, i.e. `MAX_BF_BYTE`. */
+  EOF_BEHAVIOR_MINUS_ONE,
+} EofBehavior;
+
+typedef enum {
+  /* Plain x86-64 instructions only. */
+  SIMD_EXTENSION_NONE,
+  /* 16 bytes at a time, every x86-64 CPU has it. */
+  SIMD_EXTENSION_SSE2,
+  /* 32 bytes at a time, the program crashes on CPUs without it. */
+  SIMD_EXTENSION_AVX2,
+} SimdExtension;
+
 typedef struct {
   int overflow_behavior;
   /* Size in sizeof() units. */
   int byte_size;
+  /* How many cells compile-time evaluation gets, and the interpreter starts with. */
+  int tape_size;
+  /* How many cells the tape can grow to, the generated program reserves them all. */
+  int max_tape_size;
+  /* If set, the generated program backs its first `tape_size` cells up front. */
+  int prefault_tape;
+  /* How many printed bytes the generated program collects before a `write`. */
+  int output_buffer_size;
+  /* If set, the generated program also flushes its output on every newline. */
+  int line_buffered;
+  /* How many bytes the generated program asks for with each `read`. */
+  int input_buffer_size;
+  /* What an input op does once there is no more input. */
+  int eof_behavior;
+  /* How many ops may be evaluated at compile-time, `0` disables it. */
+  long max_evaluation_steps;
+  /* The widest vector instructions the generated program may use. */
+  int simd_extension;
 } Parameters;
 
 extern Parameters G_PARAMETERS;
@@ -0,0 +1,190 @@
+#include "profile.h"
+#include "log.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/* A loop is hot if it took at least 1/HOT_LOOP_SHARE of all iterations */
+#define HOT_LOOP_SHARE (32)
+/* And ran at least this often, so tiny programs don't get bloated for nothing */
+#define MIN_HOT_ITERATIONS (1000)
+/* How many of the hottest loops get reported */
+#define REPORTED_LOOPS (5)
+
+static unsigned long read_le(const unsigned char* bytes, int size) {
+  unsigned long n = 0;
+
+  while (size--) {
+    n = (n << 8) | bytes[size];
+  }
+
+  return n;
+}
+
+int read_profile(const char* path, Arena* arena, Profile* profile) {
+  unsigned char header[PROFILE_HEADER_SIZE];
+  unsigned char record[PROFILE_RECORD_SIZE];
+  unsigned long loops_n = 0;
+  FILE* f = NULL;
+  int success = 0;
+  int i = 0;
+
+  profile->loops = NULL;
+  profile->loops_n = 0;
+
+  f = fopen(path, "rb");
+  if (!f) {
+    log_error(0, "Could not open profile %s!", path);
+    return 0;
+  }
+
+  if (
+    fread(header, 1, sizeof (header), f) != sizeof (header)
+    || memcmp(header, PROFILE_MAGIC, strlen(PROFILE_MAGIC))
+  ) {
+    log_error(0, "%s is not a profile!", path);
+    goto done_;
+  }
+
+  loops_n = read_le(header + strlen(PROFILE_MAGIC), 8);
+  if (loops_n > INT_MAX / sizeof (ProfileLoop)) {
+    log_error(0, "Profile %s is corrupt!", path);
+    goto done_;
+  }
+
+  if (loops_n) {
+    profile->loops = arena_alloc(arena, loops_n * sizeof (ProfileLoop));
+    if (!profile->loops) {
+      log_error(0, "Out of memory for the profile");
+      goto done_;
+    }
+  }
+
+  for (i = 0; i < (int)loops_n; ++i) {
+    if (fread(record, 1, sizeof (record), f) != sizeof (record)) {
+      log_error(0, "Profile %s is truncated!", path);
+      goto done_;
+    }
+    profile->loops[i].src_start = read_le(record, 4);
+    profile->loops[i].src_end = read_le(record + 4, 4);
+    profile->loops[i].entries = read_le(record + PROFILE_ENTRIES_OFFSET, 8);
+    profile->loops[i].iterations = read_le(record + PROFILE_ITERATIONS_OFFSET, 8);
+  }
+  profile->loops_n = loops_n;
+  success = 1;
+
+done_:
+  fclose(f);
+  return success;
+}
+
+/*
+ * Reports `loop`, pointing at the first line of it.
+ */
+static void report_loop(Source* src, const ProfileLoop* loop, unsigned long total_iterations) {
+  const char* newline = NULL;
+
+  src->i = loop->src_start;
+  src->i_end = loop->src_end;
+  newline = memchr(src->text + src->i, '\n', src->i_end - src->i);
+  if (newline) {
+    src->i_end = newline - src->text;
+  }
+
+  log_info(
+    src, "profile: Loop iterated %lu times over %lu entries, %.1f%% of all iterations.",
+    loop->iterations, loop->entries, loop->iterations * 100.0 / total_iterations
+  );
+}
+
+int apply_profile(Source* src, const Ops* ops, const Profile* profile, Arena* arena, unsigned char** heats) {
+  /* Per op, the matching loop of the profile if it's a [, else -1 */
+  int* op_loops = NULL;
+  /* Heats of the loops around the current op, innermost last */
+  unsigned char* open_heats = NULL;
+  const ProfileLoop* reported[REPORTED_LOOPS] = {0};
+  const ProfileLoop* loop = NULL;
+  unsigned long total_iterations = 0;
+  int matched_n = 0;
+  int depth = 0;
+  int p = 0;
+  int op = 0;
+  int i = 0;
+
+  *heats = arena_alloc(arena, ops->len ? ops->len : 1);
+  op_loops = arena_alloc(arena, (ops->len ? ops->len : 1) * sizeof (int));
+  open_heats = arena_alloc(arena, ops->len ? ops->len : 1);
+  if (!*heats || !op_loops || !open_heats) {
+    log_error(0, "Out of memory for the profile");
+    return 0;
+  }
+
+  /* Both the loops of the profile and the ops are in source order */
+  for (op = 0; op < ops->len; ++op) {
+    op_loops[op] = -1;
+    if (OP_IF_0 != ops->types[op]) {
+      continue;
+    }
+
+    while (p < profile->loops_n && profile->loops[p].src_start < ops->spans[op].src_start) {
+      ++p;
+    }
+    if (
+      p < profile->loops_n
+      && profile->loops[p].src_start == ops->spans[op].src_start
+      && profile->loops[p].src_end == ops->spans[ops->matches[op]].src_end
+    ) {
+      op_loops[op] = p;
+      total_iterations += profile->loops[p].iterations;
+      ++matched_n;
+    }
+  }
+
+  if (profile->loops_n && !matched_n) {
+    log_warn(0, "profile: None of its loops are in this program, it's ignored.");
+  }
+
+  for (op = 0; op < ops->len; ++op) {
+    if (OP_IF_0 == ops->types[op]) {
+      open_heats[depth] = PROFILE_HEAT_WARM;
+      if (-1 != op_loops[op]) {
+        loop = profile->loops + op_loops[op];
+        if (!loop->iterations) {
+          open_heats[depth] = PROFILE_HEAT_COLD;
+        } else if (
+          loop->iterations >= MIN_HOT_ITERATIONS
+          && loop->iterations >= total_iterations / HOT_LOOP_SHARE
+        ) {
+          open_heats[depth] = PROFILE_HEAT_HOT;
+        }
+
+        /* Keeps the hottest ones sorted, hottest first */
+        for (i = REPORTED_LOOPS - 1; i >= 0; --i) {
+          if (reported[i] && reported[i]->iterations >= loop->iterations) {
+            break;
+          }
+          if (i + 1 < REPORTED_LOOPS) {
+            reported[i + 1] = reported[i];
+          }
+          reported[i] = loop;
+        }
+      }
+      ++depth;
+    }
+
+    (*heats)[op] = depth ? open_heats[depth - 1] : PROFILE_HEAT_WARM;
+
+    if (OP_IF_NOT_0 == ops->types[op]) {
+      assert(depth > 0);
+      --depth;
+    }
+  }
+
+  for (i = 0; i < REPORTED_LOOPS && reported[i] && reported[i]->iterations; ++i) {
+    report_loop(src, reported[i], total_iterations);
+  }
+
+  return 1;
+}
@@ -0,0 +1,72 @@
+#ifndef BFC_PROFILE_H
+#define BFC_PROFILE_H
+
+#include "arena.h"
+#include "op.h"
+#include "source.h"
+
+/*
+ * A program built with `Assembler.profile_path` counts how often each of
+ * its loops is entered and iterated, and writes the counts out when it's
+ * done, as the profile file:
+ *
+ * - `PROFILE_MAGIC`, then how many loops there are as a 64-bit number.
+ * - Per loop, in the order of their [, a `PROFILE_RECORD_SIZE` record of
+ *   the 32-bit `Ops.spans` start of the [ and end of the ], and the 64-bit
+ *   counts of entries and iterations.
+ *
+ * All numbers are little-endian. Loops are told apart by their spans, which
+ * only depend on the source, so the profile stays usable for compiling the
+ * same program with other options.
+ */
+#define PROFILE_MAGIC "BFCPROF1"
+#define PROFILE_HEADER_SIZE (16)
+#define PROFILE_RECORD_SIZE (24)
+/* Offsets of the counts within a record */
+#define PROFILE_ENTRIES_OFFSET (8)
+#define PROFILE_ITERATIONS_OFFSET (16)
+
+typedef enum {
+  /* Never ran when profiled, so kept small rather than fast. */
+  PROFILE_HEAT_COLD,
+  /* Nothing is known, or it ran but not enough to stand out. */
+  PROFILE_HEAT_WARM,
+  /* Took a large share of all iterations, worth spending code size on. */
+  PROFILE_HEAT_HOT,
+} ProfileHeat;
+
+typedef struct {
+  int src_start;
+  int src_end;
+  /* How many times the [ was reached */
+  unsigned long entries;
+  /* How many times the body ran */
+  unsigned long iterations;
+} ProfileLoop;
+
+typedef struct {
+  ProfileLoop* loops;
+  int loops_n;
+} Profile;
+
+/*
+ * Reads the profile file at `path` into `*profile`, allocated from `arena`.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+int read_profile(const char* path, Arena* arena, Profile* profile);
+
+/*
+ * Matches the loops of `ops` with the ones in `profile`, reports the
+ * hottest of them, and sets `*heats` to the `ProfileHeat` of every op,
+ * which is the one of the innermost loop around it.
+ *
+ * On success, returns `1`.
+ *
+ * On failure, returns `0`.
+ */
+int apply_profile(Source* src, const Ops* ops, const Profile* profile, Arena* arena, unsigned char** heats);
+
+#endif /* ifndef BFC_PROFILE_H */
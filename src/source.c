@@ -6,24 +6,59 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-void set_source_i(Source* src, const Op* op) {
-  src->i = op->src_start;
-  src->i_end = op->src_end;
+void set_source_i(Source* src, const Ops* ops, int i) {
+  src->i = ops->spans[i].src_start;
+  src->i_end = ops->spans[i].src_end;
 }
 
-Source create_source(const char* path, const char* text) {
-  Source source;
+int create_source(Source* src, const char* path, const char* text, Arena* arena) {
+  int i = 0;
 
   assert(text);
 
-  source.text = text;
-  source.path = path;
-  source.len = strlen(text);
-  source.i = 0;
-  source.i_end = 0;
-  /* source.delimiter_brackets = calloc(source.len, sizeof(*source.delimiter_brackets)); */
+  src->text = text;
+  src->path = path;
+  src->len = strlen(text);
+  src->i = 0;
+  src->i_end = 0;
+  /* src->delimiter_brackets = calloc(src->len, sizeof(*src->delimiter_brackets)); */
 
-  return source;
+  src->lines_n = 1;
+  for (i = 0; i < src->len; ++i) {
+    src->lines_n += '\n' == text[i];
+  }
+  src->line_starts = arena_alloc(arena, src->lines_n * sizeof (*src->line_starts));
+  if (!src->line_starts) {
+    log_error(0, "Could not allocate the line starts of: %s", path);
+    return 0;
+  }
+
+  src->lines_n = 1;
+  src->line_starts[0] = 0;
+  for (i = 0; i < src->len; ++i) {
+    if ('\n' == text[i]) {
+      src->line_starts[src->lines_n++] = i + 1;
+    }
+  }
+
+  return 1;
+}
+
+int get_source_line(const Source* src, int i) {
+  int low = 0;
+  int high = src->lines_n - 1;
+  int middle = 0;
+
+  /* The last line that starts at or before `i` */
+  while (low < high) {
+    middle = low + (high - low + 1) / 2;
+    if (src->line_starts[middle] <= i) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return low;
 }
 
 char* read_from_path(const char* path) {
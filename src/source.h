@@ -5,6 +5,7 @@
  * Represents an extended version of the source code,
  * with members to easen lexing.
  */
+#include "arena.h"
 #include "op.h"
 typedef struct{
   const char* text;
@@ -30,6 +31,13 @@ typedef struct{
    */
   int len;
 
+  /*
+   * Where each of the `lines_n` lines starts in `text`, so the line of an
+   * index can be looked up rather than counted.
+   */
+  int* line_starts;
+  int lines_n;
+
   /*
    * Index within text.
    */
@@ -46,11 +54,21 @@ typedef struct{
 } Source;
 
 /*
- * Updates `src->i` and `src->i_end` according to `op->src_start` and `op->src_end`.
+ * Updates `src->i` and `src->i_end` according to the span of the `i`th op.
+ */
+void set_source_i(Source* src, const Ops* ops, int i);
+
+/*
+ * Allocates its line starts from `arena`.
+ *
+ * Returns `0` if out of memory.
  */
-void set_source_i(Source* src, const Op* op);
+int create_source(Source* src, const char* path, const char* text, Arena* arena);
 
-Source create_source(const char* path, const char* text);
+/*
+ * Returns the 0 based line `i` is on.
+ */
+int get_source_line(const Source* src, int i);
 
 /*
  * Return `NULL` if failed.
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Compiles every program of tests/cases.txt with bfc, runs it, and compares
+# what it prints with what it should.
+#
+# Usage: tests/run.sh
+
+cd "$(dirname "$0")"
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+grep -v '^#' cases.txt | {
+  while read -r program input output options; do
+    [ -n "$program" ] || continue
+    [ "$input" != - ] || input=/dev/null
+
+    # shellcheck disable=SC2086
+    if ! ../bfc $options "$program" -o "$WORK/program" 2> "$WORK/log"; then
+      echo "FAIL $program: does not compile"
+      cat "$WORK/log"
+      FAILED=1
+      continue
+    fi
+    status=0
+    "$WORK/program" < "$input" > "$WORK/output" || status=$?
+    if [ "$status" -ne 0 ]; then
+      echo "FAIL $program: exited with $status"
+      FAILED=1
+    elif ! cmp -s "$WORK/output" "$output"; then
+      echo "FAIL $program: printed something else"
+      FAILED=1
+    else
+      echo "ok   $program"
+    fi
+  done
+  exit $FAILED
+}